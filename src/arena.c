@@ -0,0 +1,101 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN sizeof(max_align_t)
+
+struct arena_chunk_s
+{
+    arena_chunk_t *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+};
+
+struct arena_cleanup_s
+{
+    arena_cleanup_t *next;
+    void (*release)(void*);
+    void *ptr;
+};
+
+arena_t arena_create()
+{
+    arena_t arena;
+    arena.chunks = NULL;
+    arena.cleanups = NULL;
+    return arena;
+}
+
+void arena_destroy(arena_t *arena)
+{
+    for (arena_cleanup_t *cleanup = arena->cleanups; cleanup; cleanup = cleanup->next)
+    {
+        cleanup->release(cleanup->ptr);
+    }
+
+    arena_chunk_t *chunk = arena->chunks;
+    while (chunk)
+    {
+        arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    arena->chunks = NULL;
+    arena->cleanups = NULL;
+}
+
+// Returns zeroed memory. Requests larger than a chunk get a chunk of their own.
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    arena_chunk_t *chunk = arena->chunks;
+    if (!chunk || chunk->size - chunk->used < size)
+    {
+        size_t capacity = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        chunk = (arena_chunk_t*)malloc(sizeof(arena_chunk_t) + capacity);
+        chunk->size = capacity;
+        chunk->used = 0;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    void *ptr = (char*)chunk->data + chunk->used;
+    chunk->used += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+// The old block is abandoned to the arena.
+void *arena_grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    void *grown = arena_alloc(arena, new_size);
+    if (ptr) memcpy(grown, ptr, old_size < new_size ? old_size : new_size);
+    return grown;
+}
+
+char *arena_strndup(arena_t *arena, const char *s, size_t len)
+{
+    char *copy = (char*)arena_alloc(arena, len + 1);
+    memcpy(copy, s, len);
+    return copy;
+}
+
+char *arena_strdup(arena_t *arena, const char *s)
+{
+    return arena_strndup(arena, s, strlen(s));
+}
+
+void arena_defer(arena_t *arena, void (*release)(void*), void *ptr)
+{
+    arena_cleanup_t *cleanup = (arena_cleanup_t*)arena_alloc(arena, sizeof(arena_cleanup_t));
+    cleanup->release = release;
+    cleanup->ptr = ptr;
+    cleanup->next = arena->cleanups;
+    arena->cleanups = cleanup;
+}
\ No newline at end of file
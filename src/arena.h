@@ -0,0 +1,26 @@
+#ifndef __ARENA__
+#define __ARENA__
+
+#include <stddef.h>
+
+typedef struct arena_chunk_s arena_chunk_t;
+typedef struct arena_cleanup_s arena_cleanup_t;
+
+// Bump allocator whose memory is only ever released all at once. Objects
+// that own memory outside the arena register a cleanup to run on destroy.
+typedef struct
+{
+    arena_chunk_t *chunks;
+    arena_cleanup_t *cleanups;
+} arena_t;
+
+arena_t arena_create();
+void arena_destroy(arena_t *arena);
+
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+char *arena_strndup(arena_t *arena, const char *s, size_t len);
+char *arena_strdup(arena_t *arena, const char *s);
+void arena_defer(arena_t *arena, void (*release)(void*), void *ptr);
+
+#endif
\ No newline at end of file
@@ -5,12 +5,27 @@
 
 #include "astwalker.h"
 #include "symtable.h"
+#include "threads.h"
 
 #define NODE_SETBASE(node, _type) node->base.type = _type
 
+// Backs every node of the tree being compiled, see ast_set_arena. Each thread
+// of the compiler driver builds its own module, so the arena is per thread.
+static THREAD_LOCAL arena_t *arena = NULL;
+
+void ast_set_arena(arena_t *ast_arena)
+{
+    arena = ast_arena;
+}
+
+arena_t *ast_arena()
+{
+    return arena;
+}
+
 node_t* node_block_new(node_r *stmts)
 {
-    node_block_t *node = (node_block_t*)calloc(1, sizeof(node_block_t));
+    node_block_t *node = (node_block_t*)arena_alloc(arena, sizeof(node_block_t));
     NODE_SETBASE(node, NODE_BLOCK);
     node->stmts = stmts;
 
@@ -21,7 +36,7 @@ node_t* node_block_new(node_r *stmts)
 
 node_t *node_if_new(node_t *cond, node_t *then, node_t *els)
 {
-    node_if_t *node = (node_if_t*)calloc(1, sizeof(node_if_t));
+    node_if_t *node = (node_if_t*)arena_alloc(arena, sizeof(node_if_t));
     NODE_SETBASE(node, NODE_IF);
     node->cond = cond;
     node->then = then;
@@ -31,7 +46,7 @@ node_t *node_if_new(node_t *cond, node_t *then, node_t *els)
 
 node_t *node_loop_while_new(node_t *cond, node_t *body)
 {
-    node_loop_t *node = (node_loop_t*)calloc(1, sizeof(node_loop_t));
+    node_loop_t *node = (node_loop_t*)arena_alloc(arena, sizeof(node_loop_t));
     NODE_SETBASE(node, NODE_LOOP);
     node->type = LOOP_WHILE;
     node->init = NULL;
@@ -43,7 +58,7 @@ node_t *node_loop_while_new(node_t *cond, node_t *body)
 
 node_t *node_loop_cfor_new(node_t *init, node_t *cond, node_t *inc, node_t *body)
 {
-    node_loop_t *node = (node_loop_t*)calloc(1, sizeof(node_loop_t));
+    node_loop_t *node = (node_loop_t*)arena_alloc(arena, sizeof(node_loop_t));
     NODE_SETBASE(node, NODE_LOOP);
     node->type = LOOP_CFOR;
     node->init = init;
@@ -55,7 +70,7 @@ node_t *node_loop_cfor_new(node_t *init, node_t *cond, node_t *inc, node_t *body
 
 node_t *node_loop_forin_new(node_t *init, node_t *target, node_t *body)
 {
-    node_loop_t *node = (node_loop_t*)calloc(1, sizeof(node_loop_t));
+    node_loop_t *node = (node_loop_t*)arena_alloc(arena, sizeof(node_loop_t));
     NODE_SETBASE(node, NODE_LOOP);
     node->type = LOOP_FORIN;
     node->init = init;
@@ -67,7 +82,7 @@ node_t *node_loop_forin_new(node_t *init, node_t *target, node_t *body)
 
 node_t *node_return_new(node_t *expr)
 {
-    node_return_t *node = (node_return_t*)calloc(1, sizeof(node_return_t));
+    node_return_t *node = (node_return_t*)arena_alloc(arena, sizeof(node_return_t));
     NODE_SETBASE(node, NODE_RETURN);
     node->expr = expr;
     return (node_t*)node;
@@ -75,7 +90,7 @@ node_t *node_return_new(node_t *expr)
 
 node_t *node_var_decl_new(token_t token, token_t storage, const char *identifier, node_t *init)
 {
-    node_var_decl_t *node = (node_var_decl_t*)calloc(1, sizeof(node_var_decl_t));
+    node_var_decl_t *node = (node_var_decl_t*)arena_alloc(arena, sizeof(node_var_decl_t));
     NODE_SETBASE(node, NODE_VAR_DECL);
     node->base.token = token;
 
@@ -87,7 +102,7 @@ node_t *node_var_decl_new(token_t token, token_t storage, const char *identifier
 
 node_t *node_func_decl_new(token_t token, const char *identifier, node_var_r *params, node_block_t *body)
 {
-    node_func_decl_t *node = (node_func_decl_t*)calloc(1, sizeof(node_func_decl_t));
+    node_func_decl_t *node = (node_func_decl_t*)arena_alloc(arena, sizeof(node_func_decl_t));
     NODE_SETBASE(node, NODE_FUNC_DECL);
     node->base.token = token;
 
@@ -95,20 +110,21 @@ node_t *node_func_decl_new(token_t token, const char *identifier, node_var_r *pa
     node->body = body;
     node->params = params;
 
-    node->upvalues = (ast_upvalue_r*)calloc(1, sizeof(*node->upvalues));
+    node->upvalues = (ast_upvalue_r*)arena_alloc(arena, sizeof(*node->upvalues));
     vector_init(*node->upvalues);
     node->parent = NULL;
     return (node_t*)node;
 }
 
-node_t *node_class_decl_new(token_t token, const char *identifier, node_r *decls)
+node_t *node_class_decl_new(token_t token, const char *identifier, node_r *decls, bool is_final)
 {
-    node_class_decl_t *node = (node_class_decl_t*)calloc(1, sizeof(node_class_decl_t));
+    node_class_decl_t *node = (node_class_decl_t*)arena_alloc(arena, sizeof(node_class_decl_t));
     NODE_SETBASE(node, NODE_CLASS_DECL);
     node->base.token = token;
 
     node->identifier = identifier;
     node->decls = decls;
+    node->is_final = is_final;
 
     node->num_instvars = 0;
     node->num_staticvars = 0;
@@ -118,7 +134,7 @@ node_t *node_class_decl_new(token_t token, const char *identifier, node_r *decls
 
 node_t *node_binary_new(token_t op, node_t *left, node_t *right)
 {
-    node_binary_t *node = (node_binary_t*)calloc(1, sizeof(node_binary_t));
+    node_binary_t *node = (node_binary_t*)arena_alloc(arena, sizeof(node_binary_t));
     NODE_SETBASE(node, NODE_BINARY);
     node->base.token = op;
 
@@ -130,7 +146,7 @@ node_t *node_binary_new(token_t op, node_t *left, node_t *right)
 
 node_t *node_unary_new(token_t op, node_t *right)
 {
-    node_unary_t *node = (node_unary_t*)calloc(1, sizeof(node_unary_t));
+    node_unary_t *node = (node_unary_t*)arena_alloc(arena, sizeof(node_unary_t));
     NODE_SETBASE(node, NODE_UNARY);
     node->op = op;
     node->right = right;
@@ -139,7 +155,7 @@ node_t *node_unary_new(token_t op, node_t *right)
 
 postfix_expr_t *postfix_call_new(node_r *args)
 {
-    postfix_expr_t *expr = (postfix_expr_t*)calloc(1, sizeof(postfix_expr_t));
+    postfix_expr_t *expr = (postfix_expr_t*)arena_alloc(arena, sizeof(postfix_expr_t));
     expr->type = POST_CALL;
     expr->args = args;
     return expr;
@@ -147,7 +163,7 @@ postfix_expr_t *postfix_call_new(node_r *args)
 
 postfix_expr_t *postfix_access_new(node_t *accessor)
 {
-    postfix_expr_t *expr = (postfix_expr_t*)calloc(1, sizeof(postfix_expr_t));
+    postfix_expr_t *expr = (postfix_expr_t*)arena_alloc(arena, sizeof(postfix_expr_t));
     expr->type = POST_ACCESS;
     expr->accessor = accessor;
     return expr;
@@ -155,7 +171,7 @@ postfix_expr_t *postfix_access_new(node_t *accessor)
 
 postfix_expr_t *postfix_subscript_new(node_t *subscript)
 {
-    postfix_expr_t *expr = (postfix_expr_t*)calloc(1, sizeof(postfix_expr_t));
+    postfix_expr_t *expr = (postfix_expr_t*)arena_alloc(arena, sizeof(postfix_expr_t));
     expr->type = POST_SUBSCRIPT;
     expr->accessor = subscript;
     return expr;
@@ -163,16 +179,17 @@ postfix_expr_t *postfix_subscript_new(node_t *subscript)
 
 node_t *node_postfix_new(node_t *target, postfix_expr_r *exprs)
 {
-    node_postfix_t *node = (node_postfix_t*)calloc(1, sizeof(node_postfix_t));
+    node_postfix_t *node = (node_postfix_t*)arena_alloc(arena, sizeof(node_postfix_t));
     NODE_SETBASE(node, NODE_POSTFIX);
     node->exprs = exprs;
     node->target = target;
+    node->binding = BIND_NONE;
     return (node_t*)node;
 }
 
 node_t *node_var_new(token_t token, const char *identifier)
 {
-    node_var_t *node = (node_var_t*)calloc(1, sizeof(node_var_t));
+    node_var_t *node = (node_var_t*)arena_alloc(arena, sizeof(node_var_t));
     NODE_SETBASE(node, NODE_VAR);
     node->base.token = token;
     node->identifier = identifier;
@@ -181,7 +198,7 @@ node_t *node_var_new(token_t token, const char *identifier)
 
 node_t *node_list_new(node_r *items)
 {
-    node_list_t *node = (node_list_t*)calloc(1, sizeof(node_list_t));
+    node_list_t *node = (node_list_t*)arena_alloc(arena, sizeof(node_list_t));
     NODE_SETBASE(node, NODE_LIST);
     node->items = items;
     return (node_t*)node;
@@ -189,7 +206,7 @@ node_t *node_list_new(node_r *items)
 
 node_t *node_range_new(node_t *start, node_t *end)
 {
-    node_range_t *node = (node_range_t*)calloc(1, sizeof(node_range_t));
+    node_range_t *node = (node_range_t*)arena_alloc(arena, sizeof(node_range_t));
     NODE_SETBASE(node, NODE_RANGE);
     node->start = start;
     node->end = end;
@@ -198,7 +215,7 @@ node_t *node_range_new(node_t *start, node_t *end)
 
 node_t *node_literal_int_new(int value)
 {
-    node_literal_t *node = (node_literal_t*)calloc(1, sizeof(node_literal_t));
+    node_literal_t *node = (node_literal_t*)arena_alloc(arena, sizeof(node_literal_t));
     NODE_SETBASE(node, NODE_LITERAL);
     node->type = LITERAL_INT;
     node->u.i = value;
@@ -207,7 +224,7 @@ node_t *node_literal_int_new(int value)
 
 node_t *node_literal_float_new(double value)
 {
-    node_literal_t *node = (node_literal_t*)calloc(1, sizeof(node_literal_t));
+    node_literal_t *node = (node_literal_t*)arena_alloc(arena, sizeof(node_literal_t));
     NODE_SETBASE(node, NODE_LITERAL);
     node->type = LITERAL_FLT;
     node->u.d = value;
@@ -216,7 +233,7 @@ node_t *node_literal_float_new(double value)
 
 node_t *node_literal_str_new(const char *value, int len)
 {
-    node_literal_t *node = (node_literal_t*)calloc(1, sizeof(node_literal_t));
+    node_literal_t *node = (node_literal_t*)arena_alloc(arena, sizeof(node_literal_t));
     NODE_SETBASE(node, NODE_LITERAL);
     node->type = LITERAL_STR;
     node->u.s = value;
@@ -226,197 +243,30 @@ node_t *node_literal_str_new(const char *value, int len)
 
 node_t * node_literal_bool_new(bool value)
 {
-    node_literal_t *node = (node_literal_t*)calloc(1, sizeof(node_literal_t));
+    node_literal_t *node = (node_literal_t*)arena_alloc(arena, sizeof(node_literal_t));
     NODE_SETBASE(node, NODE_LITERAL);
     node->type = LITERAL_BOOL;
     node->u.i = value;
     return (node_t*)node;
 }
 
-static void free_node_block(astwalker_t *self, node_block_t *node)
-{
-    if (node->stmts)
-    {
-        for (int i = 0; i < vector_size(*node->stmts); i++)
-        {
-            node_t* child = vector_get(*node->stmts, i);
-            if (child)
-                walk_ast(self, child);
-        }
-        vector_destroy(*node->stmts);
-        free(node->stmts);
-    }
-    if (node->is_root && node->symtable) symtable_free(node->symtable);
-    free(node);
-}
-
-static void free_node_if(astwalker_t *self, node_if_t *node)
-{
-    if (node->cond) walk_ast(self, node->cond);
-    if (node->then) walk_ast(self, node->then);
-    if (node->els) walk_ast(self, node->els);
-    free(node);
-}
-
-static void free_node_loop(astwalker_t *self, node_loop_t *node)
-{
-    if (node->init) walk_ast(self, node->init);
-    if (node->cond) walk_ast(self, node->cond);
-    if (node->inc) walk_ast(self, node->inc);
-    if (node->body) walk_ast(self, node->body);
-    if (node->iterator) free((char*)node->iterator);
-    free(node);
-}
-
-static void free_node_return(astwalker_t *self, node_return_t *node)
-{
-    if (node->expr) walk_ast(self, node->expr);
-    free(node);
-}
-
-static void free_node_var_decl(astwalker_t *self, node_var_decl_t *node)
-{
-    if (node->ident) free((char*)node->ident);
-    if (node->init) walk_ast(self, node->init);
-    free(node);
-}
-
-static void free_node_func_decl(astwalker_t *self, node_func_decl_t *node)
-{
-    if (node->body) walk_ast(self, (node_t*)node->body);
-    if (node->params)
-    {
-        for (int i = 0; i < vector_size(*node->params); i++)
-        {
-            walk_ast(self, (node_t*)vector_get(*node->params, i));
-        }
-        vector_destroy(*node->params);
-        free(node->params);
-    }
-    if (node->upvalues)
-    {
-        vector_destroy(*node->upvalues);
-        free(node->upvalues);
-    }
-    if (node->symtable) symtable_free(node->symtable);
-
-    free(node);
-}
-
-static void free_node_class_decl(astwalker_t *self, node_class_decl_t *node)
+node_t *node_concat_new(node_r *parts)
 {
-    if (node->identifier) free((char*)node->identifier);
-    if (node->symtable) symtable_free(node->symtable);
-    if (node->decls)
-    {
-        for (size_t i = 0; i < vector_size(*node->decls); i++)
-        {
-            walk_ast(self, vector_get(*node->decls, i));
-        }
-        vector_destroy(*node->decls);
-        free(node->decls);
-    }
-
-    free(node);
-}
-
-static void free_node_binary(astwalker_t *self, node_binary_t *node)
-{
-    if (node->left) walk_ast(self, node->left);
-    if (node->right) walk_ast(self, node->right);
-    node->left = NULL;
-    node->right = NULL;
-    free(node);
-}
-
-static void free_node_unary(astwalker_t *self, node_unary_t *node)
-{
-    if (node->right) walk_ast(self, node->right);
-    free(node);
-}
-
-static void free_node_postfix(astwalker_t *self, node_postfix_t *node)
-{
-    if (node->exprs)
-    {
-        for (size_t i = 0; i < vector_size(*node->exprs); i++)
-        {
-            postfix_expr_t *expr = vector_get(*node->exprs, i);
-            if (expr->type == POST_CALL && expr->args)
-            {
-                for (size_t j = 0; j < vector_size(*expr->args); j++)
-                {
-                    walk_ast(self, vector_get(*expr->args, j));
-                }
-                vector_destroy(*expr->args);
-                free(expr->args);
-            }
-            else if (expr->type == POST_ACCESS || expr->type == POST_SUBSCRIPT)
-            {
-                walk_ast(self, expr->accessor);
-            }
-        }
-        vector_destroy(*node->exprs);
-        free(node->exprs);
-    }
-    if (node->target) free(node->target);
-    free(node);
-}
-
-static void free_node_var(astwalker_t *self, node_var_t *node)
-{
-    if (node->identifier) free((char*)node->identifier);
-    free(node);
-}
-
-static void free_node_list(astwalker_t *self, node_list_t *node)
-{
-    if (node->items)
-    {
-        for (size_t i = 0; i < vector_size(*node->items); i++)
-        {
-            walk_ast(self, vector_get(*node->items, i));
-        }
-        vector_destroy(*node->items);
-        free(node->items);
-    }
-    free(node);
-}
-
-static void free_node_range(astwalker_t *self, node_range_t *node)
-{
-    walk_ast(self, node->start);
-    walk_ast(self, node->end);
-    free(node);
-}
-
-static void free_node_literal(astwalker_t *self, node_literal_t *node)
-{
-    if (node->type == LITERAL_STR) free((char*)node->u.s);
-    free(node);
+    node_concat_t *node = (node_concat_t*)arena_alloc(arena, sizeof(node_concat_t));
+    NODE_SETBASE(node, NODE_CONCAT);
+    node->parts = parts;
+    return (node_t*)node;
 }
 
-void ast_free(node_t *root)
+node_t *node_import_new(token_t token, const char *path)
 {
-    astwalker_t visitor = {
-        .visit_block = free_node_block,
-        .visit_if = free_node_if,
-        .visit_loop = free_node_loop,
-        .visit_return = free_node_return,
-
-        .visit_var_decl = free_node_var_decl,
-        .visit_func_decl = free_node_func_decl,
-        .visit_class_decl = free_node_class_decl,
-
-        .visit_binary = free_node_binary,
-        .visit_unary = free_node_unary,
-        .visit_postfix = free_node_postfix,
-        .visit_var = free_node_var,
-        .visit_list = free_node_list,
-        .visit_range = free_node_range,
-        .visit_literal = free_node_literal
-    };
-    walk_ast(&visitor, root);
+    node_import_t *node = (node_import_t*)arena_alloc(arena, sizeof(node_import_t));
+    NODE_SETBASE(node, NODE_IMPORT);
+    node->base.token = token;
+    node->path = path;
+    node->module = NULL;
+    node->names = (ast_import_r*)arena_alloc(arena, sizeof(ast_import_r));
+    return (node_t*)node;
 }
 
 static void print_tabs(int depth)
@@ -557,7 +407,7 @@ static void print_node_func_decl(astwalker_t *self, node_func_decl_t *node)
 
 static void print_node_class_decl(astwalker_t *self, node_class_decl_t *node)
 {
-    printf("[class_decl] ident: %s\n", node->identifier);
+    printf("[class_decl] ident: %s%s\n", node->identifier, node->is_final ? " (final)" : "");
     int depth = self->depth;
 
     if (node->decls)
@@ -704,6 +554,26 @@ static void print_node_literal(astwalker_t *self, node_literal_t *node)
     }
 }
 
+static void print_node_concat(astwalker_t *self, node_concat_t *node)
+{
+    printf("[concat] nparts: %ld\n", vector_size(*node->parts));
+    int depth = self->depth;
+
+    for (int i = 0; i < vector_size(*node->parts); i++)
+    {
+        print_tabs(depth);
+        self->depth = depth + 1;
+        walk_ast(self, vector_get(*node->parts, i));
+    }
+
+    self->depth = depth;
+}
+
+static void print_node_import(astwalker_t *self, node_import_t *node)
+{
+    printf("[import] path: %s\n", node->path);
+}
+
 void ast_print(node_t *root)
 {
     astwalker_t visitor = {
@@ -724,7 +594,9 @@ void ast_print(node_t *root)
         .visit_var = print_node_var,
         .visit_list = print_node_list,
         .visit_range = print_node_range,
-        .visit_literal = print_node_literal
+        .visit_literal = print_node_literal,
+        .visit_concat = print_node_concat,
+        .visit_import = print_node_import
     };
     walk_ast(&visitor, root);
 }
\ No newline at end of file
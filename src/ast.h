@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 
+#include "arena.h"
 #include "token.h"
 #include "vector.h"
 
@@ -15,7 +16,9 @@ typedef enum
     NODE_VAR_DECL, NODE_FUNC_DECL, NODE_CLASS_DECL,
 
     NODE_UNARY, NODE_BINARY, NODE_POSTFIX, NODE_VAR, NODE_LIST, 
-    NODE_RANGE, NODE_LITERAL
+    NODE_RANGE, NODE_LITERAL, NODE_CONCAT,
+
+    NODE_IMPORT
 
 } node_type;
 
@@ -25,6 +28,12 @@ typedef enum
 } literal_type;
 
 
+// Operand types of a binary expression proven by type inference.
+typedef enum
+{
+    OPERANDS_ANY, OPERANDS_INT, OPERANDS_FLOAT
+} operand_type;
+
 typedef enum
 {
     LOC_LOCAL,
@@ -134,6 +143,7 @@ typedef struct
     node_t base;
     const char *identifier;
     node_r *decls;
+    bool is_final;
 
     symtable_t *symtable;
     uint8_t idx;
@@ -149,6 +159,8 @@ typedef struct
     token_t op;
     node_t *left;
     node_t *right;
+
+    operand_type operands;
 } node_binary_t;
 
 typedef struct
@@ -171,6 +183,14 @@ typedef struct
 
 typedef vector_t(postfix_expr_t*) postfix_expr_r;
 
+// How a call of a sibling method from inside a method reaches its target.
+typedef enum
+{
+    BIND_NONE,
+    BIND_SELF,      // looked up in the object the calling method runs on
+    BIND_DIRECT     // the class is final, so the method slot is called directly
+} binding_type;
+
 typedef struct
 {
     node_t base;
@@ -178,6 +198,7 @@ typedef struct
     
     postfix_expr_r *exprs;
 
+    binding_type binding;
 } node_postfix_t;
 
 typedef struct node_var_s
@@ -204,6 +225,14 @@ typedef struct
     node_t *end;
 } node_range_t;
 
+// Converts every part to a string and joins them, built from template strings.
+typedef struct
+{
+    node_t base;
+
+    node_r *parts;
+} node_concat_t;
+
 typedef struct
 {
     node_t base;
@@ -217,6 +246,30 @@ typedef struct
     } u;
 } node_literal_t;
 
+// A name brought in by an import: its global slot in the importing module
+// and the slot it was declared in by the imported module.
+typedef struct
+{
+    uint8_t idx;
+    uint8_t module_idx;
+} ast_import_t;
+
+typedef vector_t(ast_import_t) ast_import_r;
+
+typedef struct
+{
+    node_t base;
+    const char *path;
+
+    // root of the imported module, set by the compiler driver
+    node_block_t *module;
+    ast_import_r *names;
+} node_import_t;
+
+// Nodes, their vectors and strings are allocated from the arena set here
+// and are only released together when the arena is destroyed.
+void ast_set_arena(arena_t *arena);
+arena_t *ast_arena();
 
 node_t *node_block_new(node_r *stmts);
 node_t *node_if_new(node_t *cond, node_t *then, node_t *els);
@@ -227,7 +280,7 @@ node_t *node_return_new(node_t *expr);
 
 node_t *node_var_decl_new(token_t token, token_t storage, const char *identifier, node_t *init);
 node_t *node_func_decl_new(token_t token, const char *identifier, node_var_r *params, node_block_t *body);
-node_t *node_class_decl_new(token_t token, const char *identifier, node_r *decls);
+node_t *node_class_decl_new(token_t token, const char *identifier, node_r *decls, bool is_final);
 
 node_t *node_binary_new(token_t op, node_t *left, node_t *right);
 node_t *node_unary_new(token_t op, node_t *right);
@@ -242,8 +295,9 @@ node_t *node_literal_int_new(int value);
 node_t *node_literal_float_new(double value);
 node_t *node_literal_str_new(const char *value, int len);
 node_t *node_literal_bool_new(bool value);
+node_t *node_concat_new(node_r *parts);
+node_t *node_import_new(token_t token, const char *path);
 
-void ast_free(node_t *root);
 void ast_print(node_t *root);
 
 #endif
\ No newline at end of file
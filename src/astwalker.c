@@ -24,5 +24,8 @@ void walk_ast(astwalker_t *self, node_t *node)
     case NODE_LIST: VISIT(list);
     case NODE_RANGE: VISIT(range);
     case NODE_LITERAL: VISIT(literal);
+    case NODE_CONCAT: VISIT(concat);
+
+    case NODE_IMPORT: VISIT(import);
     }
 }
\ No newline at end of file
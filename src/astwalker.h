@@ -28,6 +28,8 @@ typedef struct astwalker
     void(* visit_list)(struct astwalker *self, node_list_t *node);
     void(* visit_range)(struct astwalker *self, node_range_t *node);
     void(* visit_literal)(struct astwalker *self, node_literal_t *node);
+    void(* visit_concat)(struct astwalker *self, node_concat_t *node);
+    void(* visit_import)(struct astwalker *self, node_import_t *node);
 } astwalker_t;
 
 void walk_ast(astwalker_t *self, node_t *node);
@@ -0,0 +1,344 @@
+#include "bytecode.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "hash.h"
+#include "utils.h"
+
+static const char magic[4] = { 'M', 'L', 'N', 'C' };
+
+typedef enum
+{
+    TAG_NULL, TAG_BOOL, TAG_INT, TAG_FLOAT, TAG_STR, TAG_CLOSURE, TAG_CLASS
+} value_tag;
+
+typedef struct
+{
+    FILE *file;
+    bool failed;
+} writer_t;
+
+typedef struct
+{
+    const uint8_t *pos;
+    const uint8_t *end;
+    bool failed;
+} reader_t;
+
+static void write_bytes(writer_t *w, const void *data, size_t size)
+{
+    if (size > 0 && fwrite(data, size, 1, w->file) != 1) w->failed = true;
+}
+
+static void write_u8(writer_t *w, uint8_t v) { write_bytes(w, &v, sizeof(v)); }
+static void write_u32(writer_t *w, uint32_t v) { write_bytes(w, &v, sizeof(v)); }
+static void write_i32(writer_t *w, int32_t v) { write_bytes(w, &v, sizeof(v)); }
+static void write_f64(writer_t *w, double v) { write_bytes(w, &v, sizeof(v)); }
+
+// Strings keep their terminator so the loader can use them in place.
+static void write_str(writer_t *w, const char *s, uint32_t len)
+{
+    write_u32(w, len);
+    write_bytes(w, s, len);
+    write_u8(w, 0);
+}
+
+static void write_function(writer_t *w, function_t *f);
+static void write_class(writer_t *w, class_t *c);
+
+static void write_value(writer_t *w, value_t v)
+{
+    if (IS_NULL(v)) write_u8(w, TAG_NULL);
+    else if (IS_BOOL(v)) { write_u8(w, TAG_BOOL); write_i32(w, AS_BOOL(v)); }
+    else if (IS_INT(v)) { write_u8(w, TAG_INT); write_i32(w, AS_INT(v)); }
+    else if (IS_FLOAT(v)) { write_u8(w, TAG_FLOAT); write_f64(w, AS_FLOAT(v)); }
+    else if (IS_STR(v))
+    {
+        write_u8(w, TAG_STR);
+        write_str(w, string_cstr(AS_STR(v)), AS_STR(v)->len);
+    }
+    else if (IS_CLOSURE(v) && AS_CLOSURE(v)->f->type == FUNC_MELON)
+    {
+        write_u8(w, TAG_CLOSURE);
+        write_function(w, AS_CLOSURE(v)->f);
+    }
+    else if (IS_CLASS(v))
+    {
+        write_u8(w, TAG_CLASS);
+        write_class(w, AS_CLASS(v));
+    }
+    else
+    {
+        w->failed = true;
+    }
+}
+
+static void write_function(writer_t *w, function_t *f)
+{
+    write_str(w, f->identifier, strlen(f->identifier));
+    write_u8(w, f->nupvalues);
+
+    write_u32(w, vector_size(f->bytecode));
+    write_bytes(w, f->bytecode.a, vector_size(f->bytecode));
+
+    write_u32(w, vector_size(f->constpool));
+    for (size_t i = 0; i < vector_size(f->constpool); i++)
+    {
+        write_value(w, vector_get(f->constpool, i));
+    }
+}
+
+static void write_bindings(writer_t *w, hashtable_t *htable)
+{
+    write_u32(w, htable->nentrys);
+    for (uint32_t i = 0; i < htable->size; i++)
+    {
+        for (hash_entry_t *entry = htable->table[i]; entry; entry = entry->next)
+        {
+            string_t *key = AS_STR(entry->key);
+            write_str(w, string_cstr(key), key->len);
+            write_value(w, entry->value);
+        }
+    }
+}
+
+static void write_class(writer_t *w, class_t *c)
+{
+    write_str(w, c->identifier, strlen(c->identifier));
+    write_u8(w, c->meta_inited);
+    write_bindings(w, c->htable);
+    write_bindings(w, c->metaclass->htable);
+}
+
+bool bytecode_write_file(function_t *func, FILE *file)
+{
+    writer_t w = { .file = file, .failed = false };
+    write_bytes(&w, magic, sizeof(magic));
+    write_u32(&w, BYTECODE_VERSION);
+    write_function(&w, func);
+    return !w.failed;
+}
+
+bool bytecode_write(function_t *func, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+
+    bool written = bytecode_write_file(func, file);
+    if (fclose(file) != 0) written = false;
+    if (!written) remove(path);
+    return written;
+}
+
+static const uint8_t *read_bytes(reader_t *r, size_t size)
+{
+    if (r->failed || (size_t)(r->end - r->pos) < size)
+    {
+        r->failed = true;
+        return NULL;
+    }
+    const uint8_t *data = r->pos;
+    r->pos += size;
+    return data;
+}
+
+#define READ_SCALAR(name, type)                             \
+    static type name(reader_t *r)                           \
+    {                                                       \
+        type v = 0;                                         \
+        const uint8_t *data = read_bytes(r, sizeof(type));  \
+        if (data) memcpy(&v, data, sizeof(type));           \
+        return v;                                           \
+    }
+
+READ_SCALAR(read_u8, uint8_t)
+READ_SCALAR(read_u32, uint32_t)
+READ_SCALAR(read_i32, int32_t)
+READ_SCALAR(read_f64, double)
+
+static const char *read_str(reader_t *r)
+{
+    uint32_t len = read_u32(r);
+    const char *s = (const char*)read_bytes(r, (size_t)len + 1);
+    if (!s || s[len] != '\0' || memchr(s, '\0', len))
+    {
+        r->failed = true;
+        return NULL;
+    }
+    return s;
+}
+
+static function_t *read_function(reader_t *r);
+static class_t *read_class(reader_t *r);
+
+static value_t read_value(reader_t *r)
+{
+    switch (read_u8(r))
+    {
+    case TAG_NULL: return FROM_NULL;
+    case TAG_BOOL: return FROM_BOOL(read_i32(r));
+    case TAG_INT: return FROM_INT(read_i32(r));
+    case TAG_FLOAT: return FROM_FLOAT(read_f64(r));
+    case TAG_STR:
+    {
+        const char *s = read_str(r);
+        if (s) return FROM_ISTR(s);
+        break;
+    }
+    case TAG_CLOSURE:
+    {
+        function_t *f = read_function(r);
+        if (f) return FROM_CLOSURE(closure_new(f));
+        break;
+    }
+    case TAG_CLASS:
+    {
+        class_t *c = read_class(r);
+        if (c) return FROM_CLASS(c);
+        break;
+    }
+    }
+    r->failed = true;
+    return FROM_NULL;
+}
+
+// The vm trusts its bytecode, so a loaded function is rejected unless every
+// instruction is known and complete, its constants exist and its jumps land
+// on an instruction.
+static bool verify_code(function_t *f)
+{
+    uint32_t length = f->bytecode.n;
+    const uint8_t *code = f->bytecode.a;
+    uint8_t *starts = (uint8_t*)calloc(length + 1, 1);
+    bool valid = true;
+
+    for (uint32_t pos = 0; pos < length && valid; pos += op_length((opcode)code[pos]))
+    {
+        starts[pos] = 1;
+        valid = code[pos] <= OP_HALT && pos + op_length((opcode)code[pos]) <= length;
+        if (valid && code[pos] == OP_LOADK) valid = code[pos + 1] < vector_size(f->constpool);
+    }
+
+    for (uint32_t pos = 0; pos < length && valid; pos += op_length((opcode)code[pos]))
+    {
+        uint8_t op = code[pos];
+        if (op != OP_JMP && op != OP_LOOP && op != OP_JIF) continue;
+
+        uint8_t offset = code[pos + 1];
+        if (op == OP_LOOP && offset > pos + 1) valid = false;
+        else
+        {
+            uint32_t target = op == OP_LOOP ? pos + 1 - offset : pos + 1 + offset;
+            valid = target < length && starts[target];
+        }
+    }
+
+    free(starts);
+    return valid;
+}
+
+static function_t *read_function(reader_t *r)
+{
+    const char *identifier = read_str(r);
+    if (!identifier) return NULL;
+
+    function_t *f = function_new(strdup(identifier));
+    f->nupvalues = read_u8(r);
+
+    uint32_t length = read_u32(r);
+    const uint8_t *code = read_bytes(r, length);
+    if (code && length > 0)
+    {
+        vector_realloc(uint8_t, f->bytecode, length);
+        memcpy(f->bytecode.a, code, length);
+        f->bytecode.n = length;
+    }
+
+    uint32_t nconstants = read_u32(r);
+    for (uint32_t i = 0; i < nconstants && !r->failed; i++)
+    {
+        value_t v = read_value(r);
+        if (!r->failed) vector_push(value_t, f->constpool, v);
+    }
+
+    if (r->failed || !verify_code(f))
+    {
+        function_free(f);
+        return NULL;
+    }
+    return f;
+}
+
+static void read_bindings(reader_t *r, class_t *c)
+{
+    uint32_t count = read_u32(r);
+    for (uint32_t i = 0; i < count && !r->failed; i++)
+    {
+        const char *key = read_str(r);
+        if (!key) return;
+        value_t v = read_value(r);
+        if (!r->failed) class_bind(c, key, v);
+    }
+}
+
+// Static storage is allocated by the vm when the class is first loaded.
+static class_t *read_class(reader_t *r)
+{
+    const char *identifier = read_str(r);
+    if (!identifier) return NULL;
+
+    class_t *c = class_new_with_meta(strdup(identifier), 0, 0, melon_class_object);
+    c->meta_inited = read_u8(r);
+    read_bindings(r, c);
+    read_bindings(r, c->metaclass);
+
+    if (r->failed)
+    {
+        class_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+static bool read_header(reader_t *r)
+{
+    const uint8_t *header = read_bytes(r, sizeof(magic));
+    return header && memcmp(header, magic, sizeof(magic)) == 0 && read_u32(r) == BYTECODE_VERSION;
+}
+
+function_t *bytecode_read(const void *data, size_t size)
+{
+    reader_t r = { .pos = (const uint8_t*)data, .end = (const uint8_t*)data + size, .failed = false };
+    if (!read_header(&r)) return NULL;
+
+    function_t *func = read_function(&r);
+    if (func && r.pos != r.end)
+    {
+        function_free(func);
+        return NULL;
+    }
+    return func;
+}
+
+function_t *bytecode_load(const char *path)
+{
+    size_t size = 0;
+    const void *data = file_map(path, &size);
+    if (!data)
+    {
+        printf("melon fatal : Could not load file at %s\n", path);
+        return NULL;
+    }
+
+    reader_t r = { .pos = (const uint8_t*)data, .end = (const uint8_t*)data + size, .failed = false };
+    function_t *func = NULL;
+    if (!read_header(&r)) printf("melon fatal : %s is not a bytecode file of this version\n", path);
+    else if (!(func = bytecode_read(data, size))) printf("melon fatal : Corrupted bytecode file %s\n", path);
+
+    file_unmap(data, size);
+    return func;
+}
\ No newline at end of file
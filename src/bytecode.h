@@ -0,0 +1,32 @@
+#ifndef __BYTECODE__
+#define __BYTECODE__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "value.h"
+
+#define BYTECODE_EXTENSION ".melonc"
+
+// Bumped whenever the opcodes or the layout below change; files with another
+// version are rejected.
+#define BYTECODE_VERSION 2
+
+// Writes a compiled main function with its constants, nested closures and
+// classes to a .melonc file. Reports nothing, the caller decides how to fail.
+bool bytecode_write(function_t *func, const char *path);
+
+// Same as bytecode_write, at the current position of a file opened for writing.
+bool bytecode_write_file(function_t *func, FILE *file);
+
+// Rebuilds the main function from the contents of a .melonc file, or returns
+// NULL without reporting anything if they are not valid bytecode.
+function_t *bytecode_read(const void *data, size_t size);
+
+// Maps a .melonc file and rebuilds the main function from it, or returns NULL.
+// Strings are interned straight from the mapping and only the bytecode of each
+// function is copied.
+function_t *bytecode_load(const char *path);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bytecode.h"
+#include "module.h"
+#include "utils.h"
+
+#define CACHE_PATH_SIZE 1024
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+
+// FNV-1a, wide enough that distinct sources practically never share an entry.
+static uint64_t hash_update(uint64_t h, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Imports are resolved relative to the input file, so its location is part
+// of the key: the same text elsewhere may import different modules.
+static uint64_t cache_key(const char *path, const char *source, uint32_t inline_budget)
+{
+    uint32_t versions[2] = { BYTECODE_VERSION, COMPILER_VERSION };
+    uint64_t h = FNV_OFFSET;
+    h = hash_update(h, versions, sizeof(versions));
+    h = hash_update(h, &inline_budget, sizeof(inline_budget));
+
+    char *resolved = path_resolve(path);
+    h = hash_update(h, resolved ? resolved : path, strlen(resolved ? resolved : path) + 1);
+    free(resolved);
+
+    return hash_update(h, source, strlen(source));
+}
+
+static const char *cache_dir()
+{
+    const char *dir = getenv(CACHE_DIR_ENV);
+    return dir && dir[0] ? dir : CACHE_DEFAULT_DIR;
+}
+
+static bool cache_path(char *buffer, const char *path, const char *source, uint32_t inline_budget)
+{
+    int len = snprintf(buffer, CACHE_PATH_SIZE, "%s/%016llx" BYTECODE_EXTENSION,
+        cache_dir(), (unsigned long long)cache_key(path, source, inline_budget));
+    return len > 0 && len < CACHE_PATH_SIZE;
+}
+
+// Zero for a module that can no longer be read, which no stored hash matches
+// in practice.
+static uint64_t module_hash(const char *path)
+{
+    const char *source = file_read(path);
+    if (!source) return 0;
+
+    uint64_t h = hash_update(FNV_OFFSET, source, strlen(source));
+    free((void*)source);
+    return h;
+}
+
+static bool read_u32(const uint8_t **pos, const uint8_t *end, uint32_t *v)
+{
+    if ((size_t)(end - *pos) < sizeof(*v)) return false;
+    memcpy(v, *pos, sizeof(*v));
+    *pos += sizeof(*v);
+    return true;
+}
+
+// Entries start with the modules the program imports: a count, then the
+// length, path and contents hash of each. The bytecode follows.
+static bool deps_unchanged(const uint8_t **pos, const uint8_t *end)
+{
+    uint32_t ndeps = 0;
+    if (!read_u32(pos, end, &ndeps)) return false;
+
+    for (uint32_t i = 0; i < ndeps; i++)
+    {
+        uint32_t len = 0;
+        uint64_t hash = 0;
+        if (!read_u32(pos, end, &len) || (size_t)(end - *pos) < len + 1 + sizeof(hash)) return false;
+
+        const char *dep = (const char*)*pos;
+        if (dep[len] != '\0') return false;
+        memcpy(&hash, *pos + len + 1, sizeof(hash));
+        *pos += len + 1 + sizeof(hash);
+
+        if (module_hash(dep) != hash) return false;
+    }
+    return true;
+}
+
+function_t *cache_load(const char *path, const char *source, uint32_t inline_budget)
+{
+    char entry[CACHE_PATH_SIZE];
+    if (!cache_path(entry, path, source, inline_budget)) return NULL;
+
+    size_t size = 0;
+    const void *data = file_map(entry, &size);
+    if (!data) return NULL;
+
+    // an unreadable or outdated entry is treated as a miss and overwritten by cache_store
+    const uint8_t *pos = (const uint8_t*)data;
+    const uint8_t *end = pos + size;
+    function_t *func = NULL;
+    if (deps_unchanged(&pos, end)) func = bytecode_read(pos, end - pos);
+
+    file_unmap(data, size);
+    return func;
+}
+
+static bool write_deps(FILE *file, string_r *deps)
+{
+    uint32_t ndeps = (uint32_t)vector_size(*deps);
+    bool written = fwrite(&ndeps, sizeof(ndeps), 1, file) == 1;
+
+    for (size_t i = 0; written && i < vector_size(*deps); i++)
+    {
+        const char *dep = vector_get(*deps, i);
+        uint32_t len = (uint32_t)strlen(dep);
+        uint64_t hash = module_hash(dep);
+        written = fwrite(&len, sizeof(len), 1, file) == 1 && fwrite(dep, len + 1, 1, file) == 1
+            && fwrite(&hash, sizeof(hash), 1, file) == 1;
+    }
+    return written;
+}
+
+void cache_store(const char *path, const char *source, uint32_t inline_budget, function_t *func, string_r *deps)
+{
+    char entry[CACHE_PATH_SIZE];
+    char tmp[CACHE_PATH_SIZE + 32];
+    if (!cache_path(entry, path, source, inline_budget) || !dir_create(cache_dir())) return;
+
+    // written aside and renamed so concurrent runs never see a partial file
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", entry, process_id());
+    FILE *file = fopen(tmp, "wb");
+    if (!file) return;
+
+    bool written = write_deps(file, deps) && bytecode_write_file(func, file);
+    if (fclose(file) != 0) written = false;
+    if (!written || !file_replace(tmp, entry)) remove(tmp);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef __CACHE__
+#define __CACHE__
+
+#include <stdint.h>
+
+#include "value.h"
+#include "vector.h"
+
+#define CACHE_DEFAULT_DIR ".melon_cache"
+#define CACHE_DIR_ENV "MELON_CACHE_DIR"
+
+// Compiled programs are cached as bytecode files named after a hash of the
+// input file's location and source text, the bytecode and compiler versions
+// and the options that change codegen, in $MELON_CACHE_DIR or ./.melon_cache.
+// An edited source or a newer compiler hashes to a new name, so stale entries
+// are never read. Each entry also lists the modules the program imports with
+// a hash of their contents, and is ignored once any of them changes.
+
+// Returns the cached compilation of the input file at path holding source, or NULL on a miss.
+function_t *cache_load(const char *path, const char *source, uint32_t inline_budget);
+
+// Stores a freshly compiled program that imports the modules at the paths in
+// deps; failures only mean the next run compiles again.
+void cache_store(const char *path, const char *source, uint32_t inline_budget, function_t *func, string_r *deps);
+
+#endif
\ No newline at end of file
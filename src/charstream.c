@@ -1,11 +1,13 @@
 #include "charstream.h"
 
 #include <stdio.h>
+#include <string.h>
 
 charstream_t charstream_create(const char *source)
 {
     charstream_t stream;
     stream.buffer = source;
+    stream.end = source + strlen(source);
     stream.pos = (char*)stream.buffer;
     stream.line = 1;
     stream.col = 0;
@@ -29,6 +31,22 @@ char charstream_next(charstream_t *stream)
     return ch;
 }
 
+// Skips a run of bytes at once, only stopping at newlines to keep line and col in sync.
+void charstream_advance(charstream_t *stream, unsigned int bytes)
+{
+    const char *end = stream->pos + bytes;
+    const char *newline;
+    while ((newline = memchr(stream->pos, '\n', end - stream->pos)) != NULL)
+    {
+        stream->line++;
+        stream->col = 0;
+        stream->pos = (char*)newline + 1;
+    }
+    stream->col += end - stream->pos;
+    stream->pos = (char*)end;
+    stream->offset += bytes;
+}
+
 char charstream_peek(charstream_t *stream)
 {
     return *stream->pos;
@@ -6,6 +6,7 @@
 typedef struct
 {
     const char *buffer;
+    const char *end;
     char *pos;
     unsigned int line, col, offset;
 } charstream_t;
@@ -13,6 +14,7 @@ typedef struct
 charstream_t charstream_create(const char *source);
 
 char charstream_next(charstream_t *stream);
+void charstream_advance(charstream_t *stream, unsigned int bytes);
 char charstream_peek(charstream_t *stream);
 bool charstream_eof(charstream_t *stream);
 void charstream_error(charstream_t *stream, const char *msg);
@@ -2,24 +2,39 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+#include "bytecode.h"
+#include "cache.h"
+#include "inliner.h"
 
 static void print_help()
 {
     printf("Usage  : melon.exe [options] <inputfile>\n");
-    printf("\nMelon expects input files with extension .txt\n");
+    printf("\nMelon expects input files with extension .txt, or " BYTECODE_EXTENSION " for precompiled bytecode\n");
     printf("\nOptions:\n========\n");
     printf("\n[--help]  (-h)\n        Prints this help text\n");
     printf("\n[--show-ast]  (-ast)\n        Prints the syntax tree generated after compilation\n");
     printf("\n[--disasm-func]  (-dasm)\n        Prints the disassembled bytecode after compilation\n");
     printf("\n[--dump-cpool]  (-cpool)\n        Prints the contents of the main function's constant pool after compilation\n");
+    printf("\n[--inline-budget N]  (-inline N)\n        Inlines functions whose body has at most N nodes; 0 disables inlining (default %d)\n", INLINE_DEFAULT_BUDGET);
+    printf("\n[--emit-bytecode]  (-emit)\n        Writes the compiled program next to the input file with extension " BYTECODE_EXTENSION "\n");
+    printf("\n[--no-cache]  (-nocache)\n        Always compiles from source instead of reusing a cached compilation from $" CACHE_DIR_ENV " (default " CACHE_DEFAULT_DIR ")\n");
+    printf("\n[--jobs N]  (-j N)\n        Compiles the modules of the program on N threads (default one per core)\n");
     printf("\n[--compile-only]  (-c)\n        Skips execution of the program after compilation\n");
 }
 
-static bool is_valid_input(const char *input)
+static bool has_extension(const char *input, const char *extension)
 {
     size_t len = strlen(input);
-    if (len < 4) return false;
-    return strcmp(&input[len - 4], ".txt") == 0;
+    size_t extlen = strlen(extension);
+    if (len < extlen) return false;
+    return strcmp(&input[len - extlen], extension) == 0;
+}
+
+static bool is_valid_input(const char *input)
+{
+    return has_extension(input, ".txt") || has_extension(input, BYTECODE_EXTENSION);
 }
 
 static bool is_option(const char *arg, const char *longhand, const char *shorthand)
@@ -34,6 +49,11 @@ cli_options_t parse_cli_options(int argc, char **argv)
     options.c_print_ast = false;
     options.c_func_disasm = false;
     options.c_dump_cpool = false;
+    options.c_inline_budget = INLINE_DEFAULT_BUDGET;
+    options.c_emit_bytecode = false;
+    options.c_use_cache = true;
+    options.c_jobs = 0;
+    options.c_bytecode = false;
     options.c_input = NULL;
     options.r_run = true;
 
@@ -53,6 +73,7 @@ cli_options_t parse_cli_options(int argc, char **argv)
     {
         options.opt_exit = false;
         options.c_input = argv[argc - 1];
+        options.c_bytecode = has_extension(options.c_input, BYTECODE_EXTENSION);
     }
     else
     {
@@ -74,6 +95,24 @@ cli_options_t parse_cli_options(int argc, char **argv)
         {
             options.c_dump_cpool = true;
         }
+        else if (is_option(argv[i], "--inline-budget", "-inline"))
+        {
+            if (i + 1 < argc - 1) options.c_inline_budget = (uint32_t)strtoul(argv[++i], NULL, 10);
+            else printf("melon warning : Option %s expects a node count\n", argv[i]);
+        }
+        else if (is_option(argv[i], "--emit-bytecode", "-emit"))
+        {
+            options.c_emit_bytecode = true;
+        }
+        else if (is_option(argv[i], "--no-cache", "-nocache"))
+        {
+            options.c_use_cache = false;
+        }
+        else if (is_option(argv[i], "--jobs", "-j"))
+        {
+            if (i + 1 < argc - 1) options.c_jobs = (uint32_t)strtoul(argv[++i], NULL, 10);
+            else printf("melon warning : Option %s expects a thread count\n", argv[i]);
+        }
         else if (is_option(argv[i], "--compile-only", "-c"))
         {
             options.r_run = false;
@@ -2,6 +2,7 @@
 #define __CLIOPTIONS__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct
 {
@@ -9,7 +10,14 @@ typedef struct
     bool c_print_ast;
     bool c_func_disasm;
     bool c_dump_cpool;
+    uint32_t c_inline_budget;
+    bool c_emit_bytecode;
+    bool c_use_cache;
+    // threads compiling modules, 0 for one per core
+    uint32_t c_jobs;
     const char *c_input;
+    // the input is precompiled bytecode rather than source
+    bool c_bytecode;
     bool r_run;
 } cli_options_t;
 
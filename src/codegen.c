@@ -9,6 +9,7 @@
 #include "core.h"
 #include "hash.h"
 #include "opcodes.h"
+#include "optimizer.h"
 
 #define CODE ((codegen_t*)self->data)->code
 #define LOCALS ((codegen_t*)self->data)->locals
@@ -92,22 +93,72 @@ static void emit_loadstore(byte_r *code, location_e loc, uint8_t idx, bool store
     }
 }
 
-static uint8_t cpool_add_constant(value_r *cpool, value_t v)
+static uint32_t cpool_hash(value_r *cpool, value_t v)
 {
-    if (vector_size(*cpool) > 255)
+    uint64_t payload = 0;
+    if (IS_STR(v)) payload = string_hash(AS_STR(v));
+    else if (IS_FLOAT(v)) memcpy(&payload, &v.d, sizeof(double));
+    else if (IS_INT(v) || IS_BOOL(v)) payload = (uint32_t)AS_INT(v);
+
+    uint64_t h = ((uintptr_t)cpool >> 4) ^ ((uint64_t)v.type << 56) ^ payload;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+static bool cpool_equals(value_t v1, value_t v2)
+{
+    if (IS_FLOAT(v1)) return IS_FLOAT(v2) && memcmp(&v1.d, &v2.d, sizeof(double)) == 0;
+    return value_equals(v1, v2);
+}
+
+static cpool_entry_t *cpool_find_slot(codegen_t *gen, value_r *cpool, value_t v)
+{
+    uint32_t mask = gen->cpool_capacity - 1;
+    uint32_t i = cpool_hash(cpool, v) & mask;
+    for (;;)
     {
-        printf("error: maximum amount of constants\n");
-        return 255;
+        cpool_entry_t *entry = &gen->cpool_index[i];
+        if (!entry->pool) return entry;
+        if (entry->pool == cpool && cpool_equals(entry->value, v)) return entry;
+        i = (i + 1) & mask;
     }
+}
 
-    for (int i = 0; i < vector_size(*cpool); i++)
+static void cpool_index_grow(codegen_t *gen)
+{
+    cpool_entry_t *old = gen->cpool_index;
+    uint32_t old_capacity = gen->cpool_capacity;
+
+    gen->cpool_capacity = old_capacity ? old_capacity << 1 : 64;
+    gen->cpool_index = (cpool_entry_t*)calloc(gen->cpool_capacity, sizeof(cpool_entry_t));
+    for (uint32_t i = 0; i < old_capacity; i++)
     {
-        value_t val = vector_get(*cpool, i);
-        if (value_equals(val, v)) return i;
+        if (old[i].pool) *cpool_find_slot(gen, old[i].pool, old[i].value) = old[i];
+    }
+    free(old);
+}
+
+// Constants are deduplicated per pool through the codegen side index, which
+// only lives as long as the codegen.
+static uint8_t cpool_add_constant(codegen_t *gen, value_r *cpool, value_t v)
+{
+    if ((gen->cpool_count + 1) * 4 > gen->cpool_capacity * 3) cpool_index_grow(gen);
+
+    cpool_entry_t *entry = cpool_find_slot(gen, cpool, v);
+    if (entry->pool) return entry->idx;
+
+    if (vector_size(*cpool) > 255)
+    {
+        printf("error: maximum amount of constants\n");
+        return 255;
     }
 
     vector_push(value_t, *cpool, v);
-    return vector_size(*cpool) - 1;
+    *entry = (cpool_entry_t){ .pool = cpool, .value = v, .idx = vector_size(*cpool) - 1 };
+    gen->cpool_count++;
+    return entry->idx;
 }
 
 static void gen_node_block(astwalker_t *self, node_block_t *node)
@@ -172,9 +223,9 @@ static void gen_loop_while_cfor(astwalker_t *self, node_loop_t *node)
 
 static void gen_loop_forin(astwalker_t *self, node_loop_t *node)
 {
-    uint8_t it_k = cpool_add_constant(CONSTANTS, FROM_CSTR(CORE_ITERATOR_STRING));
-    uint8_t itval_k = cpool_add_constant(CONSTANTS, FROM_CSTR(CORE_ITER_VAL_STRING));
-    uint8_t null_k = cpool_add_constant(CONSTANTS, FROM_NULL);
+    uint8_t it_k = cpool_add_constant(AS_GEN(self), CONSTANTS, FROM_ISTR(CORE_ITERATOR_STRING));
+    uint8_t itval_k = cpool_add_constant(AS_GEN(self), CONSTANTS, FROM_ISTR(CORE_ITER_VAL_STRING));
+    uint8_t null_k = cpool_add_constant(AS_GEN(self), CONSTANTS, FROM_NULL);
     walk_ast(self, node->init);
     emit_bytes(CODE, OP_LOADK, null_k);
     emit_bytes(CODE, OP_LOADK, null_k);
@@ -254,7 +305,7 @@ static void store_decl(astwalker_t *self, value_t decl, bool isstatic, node_func
         const char *identifier = AS_CLOSURE(decl)->f->identifier;
         class_bind(contextc, identifier, decl);
         emit_bytes(&contextf->bytecode, OP_LOADL, 0);
-        emit_bytes(&contextf->bytecode, OP_LOADK, cpool_add_constant(&contextf->constpool, FROM_CSTR(identifier)));
+        emit_bytes(&contextf->bytecode, OP_LOADK, cpool_add_constant(AS_GEN(self), &contextf->constpool, FROM_ISTR(identifier)));
         emit_bytes(&contextf->bytecode, OP_LOADF, 0);
     }
     else
@@ -297,7 +348,7 @@ static void gen_node_var_decl(astwalker_t *self, node_var_decl_t *node)
         else
         {
             value_r *cpool = &AS_CLOSURE(context)->f->constpool;
-            emit_bytes(CODE, (uint8_t)OP_LOADK, cpool_add_constant(cpool, FROM_NULL));
+            emit_bytes(CODE, (uint8_t)OP_LOADK, cpool_add_constant(AS_GEN(self), cpool, FROM_NULL));
         }
         emit_loadstore(CODE, node->loc, node->idx, true);
     }
@@ -312,9 +363,7 @@ static void gen_node_var_decl(astwalker_t *self, node_var_decl_t *node)
 
         if (node->init)
         {
-            value_t lookup = FROM_CSTR(CORE_INIT_STRING);
-            closure_t *initf = class_lookup_closure(c, lookup);
-            string_free(AS_STR(lookup));
+            closure_t *initf = class_lookup_closure(c, FROM_STR(core_strings.init));
             if (!initf) return;
 
             PUSH_CONTEXT(FROM_CLOSURE(initf));
@@ -339,10 +388,11 @@ static void gen_node_func_decl(astwalker_t *self, node_func_decl_t *node)
     PUSH_CONTEXT(FROM_CLOSURE(cl));
 
     walk_ast(self, (node_t*)node->body);
-    if (vector_get(*CODE, vector_size(*CODE) - 1) != OP_RETURN)
-        emit_byte(CODE, (uint8_t)OP_RET0);
+    // dropped by the optimizer when every path already returns
+    emit_byte(CODE, (uint8_t)OP_RET0);
 
     POP_CONTEXT;
+    optimize_function(f);
 
     bool is_static;
     if (!node->parent) is_static = false;
@@ -367,9 +417,16 @@ static void gen_node_class_decl(struct astwalker *self, node_class_decl_t *node)
 
     PUSH_CONTEXT(FROM_CLASS(c));
 
-    for (size_t i = 0; i < vector_size(*node->decls); i++)
+    // methods are stored in their slots before any field initializer runs,
+    // so initializers can call every method of the class
+    for (int methods = 1; methods >= 0; methods--)
     {
-        walk_ast(self, vector_get(*node->decls, i));
+        for (size_t i = 0; i < vector_size(*node->decls); i++)
+        {
+            node_var_decl_t *decl = (node_var_decl_t*)vector_get(*node->decls, i);
+            bool is_method = decl->init && decl->init->type == NODE_FUNC_DECL;
+            if (is_method == methods) walk_ast(self, (node_t*)decl);
+        }
     }
 
     POP_CONTEXT;
@@ -391,11 +448,13 @@ static void gen_node_class_decl(struct astwalker *self, node_class_decl_t *node)
     }
 
     emit_byte(&init->f->bytecode, (uint8_t)OP_RETURN);
+    optimize_function(init->f);
 
     if (meta_init)
     {
         emit_bytes(&meta_init->f->bytecode, (uint8_t)OP_LOADL, 0);
         emit_byte(&meta_init->f->bytecode, (uint8_t)OP_RETURN);
+        optimize_function(meta_init->f);
     }
 
     store_decl(self, FROM_CLASS(c), false, NULL);
@@ -403,6 +462,91 @@ static void gen_node_class_decl(struct astwalker *self, node_class_decl_t *node)
     emit_loadstore(CODE, LOC_GLOBAL, node->idx, true);
 }
 
+// Pushes every part and joins them with OP_CONCAT. Longer runs are folded every
+// 255 parts, carrying the joined prefix on as the first part of the next run.
+static void gen_concat_parts(astwalker_t *self, node_t **parts, uint32_t count)
+{
+    uint32_t pending = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        walk_ast(self, parts[i]);
+        if (++pending == UINT8_MAX)
+        {
+            emit_bytes(CODE, OP_CONCAT, pending);
+            pending = 1;
+        }
+    }
+    if (pending > 1 || count < UINT8_MAX) emit_bytes(CODE, OP_CONCAT, pending);
+}
+
+static bool is_string_expr(node_t *node)
+{
+    if (node->type == NODE_CONCAT) return true;
+    return node->type == NODE_LITERAL && ((node_literal_t*)node)->type == LITERAL_STR;
+}
+
+// A chain of `+` starting from a string, like "x=" + x + ", y=" + y, only ever
+// appends to a string, so it is compiled as one concat instead of a temporary
+// string per step.
+static bool gen_string_chain(astwalker_t *self, node_binary_t *node)
+{
+    vector_t(node_t*) parts;
+    vector_init(parts);
+
+    node_t *left = (node_t*)node;
+    while (left->type == NODE_BINARY && ((node_binary_t*)left)->op.type == TOK_ADD)
+    {
+        vector_push(node_t*, parts, ((node_binary_t*)left)->right);
+        left = ((node_binary_t*)left)->left;
+    }
+
+    bool lowered = is_string_expr(left);
+    if (lowered)
+    {
+        vector_push(node_t*, parts, left);
+        // the spine was collected right to left
+        for (size_t i = 0, j = vector_size(parts) - 1; i < j; i++, j--)
+        {
+            node_t *tmp = vector_get(parts, i);
+            vector_get(parts, i) = vector_get(parts, j);
+            vector_get(parts, j) = tmp;
+        }
+        gen_concat_parts(self, parts.a, vector_size(parts));
+    }
+
+    vector_destroy(parts);
+    return lowered;
+}
+
+static void gen_node_concat(astwalker_t *self, node_concat_t *node)
+{
+    gen_concat_parts(self, node->parts->a, vector_size(*node->parts));
+}
+
+// Picks the unchecked opcode when type inference proved both operand types.
+static opcode binary_opcode(node_binary_t *node)
+{
+    opcode op = token_to_binary_op(node->op);
+    bool ints = node->operands == OPERANDS_INT;
+    if (node->operands == OPERANDS_ANY) return op;
+
+    switch (op)
+    {
+    case OP_ADD: return ints ? OP_ADD_II : OP_ADD_FF;
+    case OP_SUB: return ints ? OP_SUB_II : OP_SUB_FF;
+    case OP_MUL: return ints ? OP_MUL_II : OP_MUL_FF;
+    case OP_DIV: return ints ? OP_DIV_II : OP_DIV_FF;
+    case OP_MOD: return ints ? OP_MOD_II : OP_MOD;
+    case OP_LT: return ints ? OP_LT_II : OP_LT_FF;
+    case OP_GT: return ints ? OP_GT_II : OP_GT_FF;
+    case OP_LTE: return ints ? OP_LTE_II : OP_LTE_FF;
+    case OP_GTE: return ints ? OP_GTE_II : OP_GTE_FF;
+    case OP_EQ: return ints ? OP_EQ_II : OP_EQ_FF;
+    case OP_NEQ: return ints ? OP_NEQ_II : OP_NEQ_FF;
+    default: return op;
+    }
+}
+
 static void gen_node_binary(astwalker_t *self, node_binary_t *node)
 {
     if (node->op.type == TOK_EQ)
@@ -414,9 +558,11 @@ static void gen_node_binary(astwalker_t *self, node_binary_t *node)
         walk_ast(self, node->left);
         return;
     }
+    if (node->op.type == TOK_ADD && gen_string_chain(self, node)) return;
+
     walk_ast(self, node->left);
     walk_ast(self, node->right);
-    emit_byte(CODE, (uint8_t)token_to_binary_op(node->op));
+    emit_byte(CODE, (uint8_t)binary_opcode(node));
 }
 
 static void gen_node_unary(astwalker_t *self, node_unary_t *node)
@@ -425,14 +571,55 @@ static void gen_node_unary(astwalker_t *self, node_unary_t *node)
     emit_byte(CODE, (uint8_t)token_to_unary_op(node->op));
 }
 
+// A sibling method called from a method receives the caller's object. Methods
+// of a final class are never reassigned, so their slot is invoked directly.
+static void gen_self_call(astwalker_t *self, node_postfix_t *node)
+{
+    node_var_t *var = (node_var_t*)node->target;
+    postfix_expr_t *call = vector_get(*node->exprs, 0);
+    uint8_t nargs = call->args ? vector_size(*call->args) : 0;
+
+    // keep_object leaves the object above the method as its receiver
+    emit_bytes(CODE, OP_LOADL, 0);
+    if (node->binding == BIND_SELF)
+    {
+        emit_bytes(CODE, OP_LOADI, var->idx);
+        emit_bytes(CODE, OP_LOADF, 1);
+    }
+
+    for (size_t j = 0; j < nargs; j++)
+    {
+        walk_ast(self, vector_get(*call->args, j));
+    }
+
+    if (node->binding == BIND_SELF)
+    {
+        emit_bytes(CODE, (uint8_t)OP_CALL, nargs + 1);
+    }
+    else
+    {
+        emit_byte(CODE, (uint8_t)OP_INVOKE);
+        emit_bytes(CODE, var->idx, nargs + 1);
+    }
+}
+
 static void gen_node_postfix(astwalker_t *self, node_postfix_t *node)
 {
-    walk_ast(self, node->target);
+    int start = 0;
+    if (node->binding != BIND_NONE)
+    {
+        gen_self_call(self, node);
+        start = 1;
+    }
+    else
+    {
+        walk_ast(self, node->target);
+    }
 
     // bool is_method = vector_get(*node->exprs, 0)->type == POST_ACCESS;
     int len = vector_size(*node->exprs);
 
-    for (int i = 0; i < len; i++)
+    for (int i = start; i < len; i++)
     {
         postfix_expr_t *expr = vector_get(*node->exprs, i);
         if (expr->type == POST_CALL)
@@ -453,7 +640,7 @@ static void gen_node_postfix(astwalker_t *self, node_postfix_t *node)
             bool is_method = i < len - 1 && vector_get(*node->exprs, i + 1)->type == POST_CALL;
             node_var_t *var = (node_var_t*)expr->accessor;
             emit_bytes(CODE, (uint8_t)OP_LOADK, 
-                cpool_add_constant(CONSTANTS, FROM_CSTR(var->identifier)));
+                cpool_add_constant(AS_GEN(self), CONSTANTS, FROM_ISTR(var->identifier)));
             if (node->base.is_assign && i == len - 1)
                 emit_byte(CODE, OP_STOREF);
             else
@@ -515,7 +702,7 @@ static void gen_node_literal(astwalker_t *self, node_literal_t *node)
     case LITERAL_BOOL:
     {
         emit_bytes(code, OP_LOADK, 
-            cpool_add_constant(constpool, FROM_BOOL(node->u.i)));
+            cpool_add_constant(AS_GEN(self), constpool, FROM_BOOL(node->u.i)));
         break;
     }
     case LITERAL_INT:
@@ -528,20 +715,20 @@ static void gen_node_literal(astwalker_t *self, node_literal_t *node)
         else
         {
             emit_bytes(code, OP_LOADK, 
-                cpool_add_constant(constpool, FROM_INT(node->u.i)));
+                cpool_add_constant(AS_GEN(self), constpool, FROM_INT(node->u.i)));
         }
         break;
     }
     case LITERAL_FLT:
     {
         emit_bytes(code, OP_LOADK, 
-            cpool_add_constant(constpool, FROM_FLOAT(node->u.d)));
+            cpool_add_constant(AS_GEN(self), constpool, FROM_FLOAT(node->u.d)));
         break;
     }
     case LITERAL_STR:
     {
         emit_bytes(code, OP_LOADK, 
-            cpool_add_constant(constpool, FROM_CSTR(node->u.s)));
+            cpool_add_constant(AS_GEN(self), constpool, FROM_ISTR(node->u.s)));
         break;
     }
     default: break;
@@ -557,6 +744,9 @@ codegen_t codegen_create(function_t *f)
     gen.constants = &f->constpool;
     vector_init(gen.decls);
     vector_push(value_t, gen.decls, FROM_CLOSURE(gen.main_cl));
+    gen.cpool_index = NULL;
+    gen.cpool_capacity = 0;
+    gen.cpool_count = 0;
     return gen;
 }
 
@@ -564,6 +754,7 @@ void codegen_destroy(codegen_t *gen)
 {
     vector_destroy(gen->decls);
     free(gen->main_cl);
+    free(gen->cpool_index);
 }
 
 bool codegen_run(codegen_t *gen, node_t *ast)
@@ -588,11 +779,13 @@ bool codegen_run(codegen_t *gen, node_t *ast)
         .visit_var = gen_node_var,
         .visit_list = gen_node_list,
         .visit_range = gen_node_range,
-        .visit_literal = gen_node_literal
+        .visit_literal = gen_node_literal,
+        .visit_concat = gen_node_concat
     };
 
     walk_ast(&walker, ast);
     emit_byte(gen->code, (uint8_t)OP_HALT);
+    optimize_function(gen->main_cl->f);
 
     return walker.nerrors == 0;
 }
\ No newline at end of file
@@ -8,6 +8,14 @@
 #include "value.h"
 #include "vector.h"
 
+// Maps a constant of a function's pool to its index while code is generated.
+typedef struct
+{
+    value_r *pool;
+    value_t value;
+    uint8_t idx;
+} cpool_entry_t;
+
 typedef struct
 {
     byte_r *code;
@@ -17,6 +25,11 @@ typedef struct
     value_r decls;
     closure_t *main_cl;
 
+    // open addressed, pool is NULL for empty slots
+    cpool_entry_t *cpool_index;
+    uint32_t cpool_capacity;
+    uint32_t cpool_count;
+
 } codegen_t;
 
 codegen_t codegen_create(function_t *f);
@@ -5,10 +5,14 @@
 
 #include "ast.h"
 #include "symtable.h"
+#include "numconv.h"
 #include "value.h"
+#include "vecmath.h"
 
 #define PRINTLN_SLOT 0
 #define PRINT_SLOT   1
+#define PARSE_INT_SLOT   16
+#define PARSE_FLOAT_SLOT 17
 #define NATIVE_CLOSURE(_cl) FROM_CLOSURE(closure_native(_cl))
 
 #define RETURN_VALUE(val)                                                               \
@@ -29,6 +33,8 @@
             return false;                                                               \
         } while (0)
 
+core_strings_t core_strings;
+
 static int value_to_int(value_t v)
 {
     if (IS_INT(v)) return AS_INT(v);
@@ -62,26 +68,35 @@ static double value_to_float(value_t v)
     return 0;
 }
 
-static string_t *value_to_string(vm_t *vm, value_t v)
+// Reads an optional index argument that must lie within [0, size].
+static bool range_arg(value_t *args, uint8_t nargs, uint8_t idx, uint32_t def, uint32_t size, uint32_t *out)
 {
-    char buffer[64];
-    if (IS_INT(v))
+    if (nargs <= idx)
     {
-        sprintf(buffer, "%d", AS_INT(v));
-        return string_new(buffer);
+        *out = def;
+        return true;
     }
+    if (!IS_INT(args[idx]) || AS_INT(args[idx]) < 0 || AS_INT(args[idx]) > size)
+        return false;
+    *out = AS_INT(args[idx]);
+    return true;
+}
+
+static string_t *value_to_string(vm_t *vm, value_t v)
+{
+    if (IS_INT(v)) return string_from_int(AS_INT(v));
     if (IS_FLOAT(v))
     {
-        sprintf(buffer, "%f", AS_FLOAT(v));
-        return string_new(buffer);
+        char buffer[NUMCONV_BUFFER_SIZE];
+        int len = num_format_double(buffer, AS_FLOAT(v));
+        return string_new_len(buffer, len);
     }
     if (IS_BOOL(v)) return string_new(AS_BOOL(v) ? "true" : "false");
     if (IS_NULL(v)) return string_new("");
     if (IS_STR(v)) return string_copy(AS_STR(v));
-    
-    value_t lookup = FROM_CSTR(CORE_TOSTR_STRING);
-    value_t *tostrv = class_lookup(value_get_class(v), lookup);
-    string_free(AS_STR(lookup));
+    if (IS_STRBUILDER(v)) return strbuilder_to_string(AS_STRBUILDER(v));
+
+    value_t *tostrv = class_lookup(value_get_class(v), FROM_STR(core_strings.tostr));
     if (tostrv)
     {
         closure_t *tostr = AS_CLOSURE(*tostrv);
@@ -95,16 +110,20 @@ static string_t *value_to_string(vm_t *vm, value_t v)
     return string_new("");
 }
 
-static string_t *concat_strings(string_t *s1, string_t *s2)
+string_t *core_value_to_string(vm_t *vm, value_t v)
 {
-    char *buffer = (char*)calloc(s1->len + s2->len + 1, sizeof(char));
-    for (size_t i = 0; i < s1->len; i++) buffer[i] = s1->s[i];
-    for (size_t i = 0; i < s2->len; i++) buffer[s1->len + i] = s2->s[i];
-    buffer[s1->len + s2->len] = '\0';
+    return value_to_string(vm, v);
+}
 
-    string_t *concat = string_new(buffer);
-    free(buffer);
-    return concat;
+#define ROPE_MIN_LENGTH 256
+
+// Both strings must be owned by the vm: long results are ropes that point at
+// them, so a string built with repeated `+` no longer copies its prefix on
+// every step and is flattened once when its contents are needed.
+static string_t *concat_strings(string_t *s1, string_t *s2)
+{
+    if (s1->len + s2->len >= ROPE_MIN_LENGTH) return string_rope(s1, s2);
+    return string_concat_str(s1, s2);
 }
 
 static bool melon_println(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
@@ -118,16 +137,14 @@ static bool melon_println(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retid
         }
         else
         {
-            value_t lookup = FROM_CSTR(CORE_TOSTR_STRING);
-            value_t *tostrv = class_lookup(value_get_class(v), lookup);
-            string_free(AS_STR(lookup));
+            value_t *tostrv = class_lookup(value_get_class(v), FROM_STR(core_strings.tostr));
             if (tostrv)
             {
                 closure_t *tostr = AS_CLOSURE(*tostrv);
                 value_t args[1] = { v };
                 value_t *ret = NULL;
                 vm_run_closure(vm, tostr, args, 1, &ret);
-                printf("%s", AS_STR(*ret)->s);
+                printf("%s", string_cstr(AS_STR(*ret)));
                 // returned string already in gc
             }
         }
@@ -147,16 +164,14 @@ static bool melon_print(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
         }
         else
         {
-            value_t lookup = FROM_CSTR(CORE_TOSTR_STRING);
-            value_t *tostrv = class_lookup(value_get_class(v), lookup);
-            string_free(AS_STR(lookup));
+            value_t *tostrv = class_lookup(value_get_class(v), FROM_STR(core_strings.tostr));
             if (tostrv)
             {
                 closure_t *tostr = AS_CLOSURE(*tostrv);
                 value_t args[1] = { v };
                 value_t *ret = NULL;
                 vm_run_closure(vm, tostr, args, 1, &ret);
-                printf("%s", AS_STR(*ret)->s);
+                printf("%s", string_cstr(AS_STR(*ret)));
                 // returned string already in gc
             }
         }
@@ -164,6 +179,29 @@ static bool melon_print(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
     RETURN;
 }
 
+// parseInt and parseFloat return null when the whole string is not a number.
+static bool melon_parse_int(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs < 1 || !IS_STR(args[0]))
+        RUNTIME_ERROR("parseInt: argument must be a string\n");
+
+    string_t *s = AS_STR(args[0]);
+    int i;
+    if (!num_parse_int(string_cstr(s), s->len, &i)) RETURN_VALUE(FROM_NULL);
+    RETURN_VALUE(FROM_INT(i));
+}
+
+static bool melon_parse_float(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs < 1 || !IS_STR(args[0]))
+        RUNTIME_ERROR("parseFloat: argument must be a string\n");
+
+    string_t *s = AS_STR(args[0]);
+    double d;
+    if (!num_parse_double(string_cstr(s), s->len, &d)) RETURN_VALUE(FROM_NULL);
+    RETURN_VALUE(FROM_FLOAT(d));
+}
+
 static bool object_class(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
 {
     value_t v = args[0];
@@ -187,7 +225,7 @@ static bool object_loadfield(vm_t *vm, value_t *args, uint8_t nargs, uint32_t re
     if (!index)
     {
         RUNTIME_ERROR("class %s does not have property %s\n",
-            value_get_class(object)->identifier, AS_STR(accessor)->s);
+            value_get_class(object)->identifier, string_cstr(AS_STR(accessor)));
     }
 
     if (IS_INT(*index))
@@ -223,7 +261,14 @@ static bool object_storefield(vm_t *vm, value_t *args, uint8_t nargs, uint32_t r
     if (!index)
     {
         RUNTIME_ERROR("class %s does not have property %s\n",
-            value_get_class(object)->identifier, AS_STR(accessor)->s);
+            value_get_class(object)->identifier, string_cstr(AS_STR(accessor)));
+    }
+
+    // methods are bound in the class itself, they have no slot to store into
+    if (!IS_INT(*index))
+    {
+        RUNTIME_ERROR("cannot assign to method %s of class %s\n",
+            string_cstr(AS_STR(accessor)), value_get_class(object)->identifier);
     }
 
     if (IS_CLASS(object))
@@ -246,11 +291,9 @@ static bool class_name(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
     value_t v = args[0];
     if (IS_CLASS(v))
     {
-        value_t name = FROM_CSTR(AS_CLASS(v)->identifier);
-        vm_push_mem(vm, name);
-        RETURN_VALUE(name);
+        RETURN_VALUE(FROM_ISTR(AS_CLASS(v)->identifier));
     }
-    RETURN_VALUE(FROM_CSTR("undefined"));
+    RETURN_VALUE(FROM_ISTR("undefined"));
 }
 
 static bool int_add(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
@@ -258,7 +301,7 @@ static bool int_add(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
     if (IS_STR(args[1]))
     {
         string_t *string = value_to_string(vm, args[0]);
-        string_t *concat = concat_strings(string, AS_STR(args[1]));
+        string_t *concat = string_concat_str(string, AS_STR(args[1]));
         vm_push_mem(vm, FROM_STR(concat));
         string_free(string);
         RETURN_VALUE(FROM_STR(concat));
@@ -273,7 +316,7 @@ static bool bool_add(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
     if (IS_STR(args[1]))
     {
         string_t *string = value_to_string(vm, args[0]);
-        string_t *concat = concat_strings(string, AS_STR(args[1]));
+        string_t *concat = string_concat_str(string, AS_STR(args[1]));
         vm_push_mem(vm, FROM_STR(concat));
         string_free(string);
         RETURN_VALUE(FROM_STR(concat));
@@ -288,7 +331,7 @@ static bool float_add(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
     if (IS_STR(args[1]))
     {
         string_t *string = value_to_string(vm, args[0]);
-        string_t *concat = concat_strings(string, AS_STR(args[1]));
+        string_t *concat = string_concat_str(string, AS_STR(args[1]));
         vm_push_mem(vm, FROM_STR(concat));
         string_free(string);
         RETURN_VALUE(FROM_STR(concat));
@@ -313,11 +356,21 @@ static bool null_add(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
 static bool string_add(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
 {
     string_t *s1 = AS_STR(args[0]);
+    if (IS_STR(args[1]))
+    {
+        value_t str = FROM_STR(concat_strings(s1, AS_STR(args[1])));
+        vm_push_mem(vm, str);
+        RETURN_VALUE(str);
+    }
+
     string_t *s2 = value_to_string(vm, args[1]);
-    value_t str = FROM_STR(concat_strings(s1, s2));
-    vm_push_mem(vm, str);
-    string_free(s2);
+    string_t *concat = concat_strings(s1, s2);
+    // a rope keeps pointing at s2, so it has to live as long as the vm
+    if (concat->kind == STRING_ROPE) vm_push_mem(vm, FROM_STR(s2));
+    else string_free(s2);
 
+    value_t str = FROM_STR(concat);
+    vm_push_mem(vm, str);
     RETURN_VALUE(str);
 }
 
@@ -330,23 +383,19 @@ static bool string_equals(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retid
 {
     string_t *s1 = AS_STR(args[0]);
     string_t *s2 = AS_STR(args[1]);
-    RETURN_VALUE(FROM_BOOL(strcmp(s1->s, s2->s) == 0));
+    RETURN_VALUE(FROM_BOOL(string_equals_str(s1, s2)));
 }
 
 static bool string_charat(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
 {
     string_t *s = AS_STR(args[0]);
     int idx = AS_INT(args[1]);
-    if (idx >= s->len)
+    if (idx < 0 || idx >= s->len)
     {
         RUNTIME_ERROR("string_charat: out of bounds\n");
     }
 
-    char buffer[4];
-    sprintf(buffer, "%c", s->s[idx]);
-    string_t *c = string_new(buffer);
-    vm_push_mem(vm, FROM_STR(c));
-    RETURN_VALUE(FROM_STR(c));
+    RETURN_VALUE(FROM_STR(string_from_char(string_data(s)[idx])));
 }
 
 static bool string_concat(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
@@ -359,17 +408,144 @@ static bool string_concat(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retid
     RETURN_VALUE(str);
 }
 
+static bool string_arg(value_t *args, uint8_t nargs, uint8_t idx)
+{
+    return nargs > idx && IS_STR(args[idx]);
+}
+
+static bool string_indexof(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!string_arg(args, nargs, 1))
+        RUNTIME_ERROR("string_indexof: argument must be a string\n");
+
+    uint32_t from = 0;
+    if (nargs > 2)
+    {
+        if (!IS_INT(args[2]) || AS_INT(args[2]) < 0)
+            RUNTIME_ERROR("string_indexof: start must be a positive int\n");
+        from = AS_INT(args[2]);
+    }
+    RETURN_VALUE(FROM_INT(string_find(AS_STR(args[0]), AS_STR(args[1]), from)));
+}
+
+static bool string_lastindexof(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!string_arg(args, nargs, 1))
+        RUNTIME_ERROR("string_lastindexof: argument must be a string\n");
+    RETURN_VALUE(FROM_INT(string_find_last(AS_STR(args[0]), AS_STR(args[1]))));
+}
+
+static bool string_contains(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!string_arg(args, nargs, 1))
+        RUNTIME_ERROR("string_contains: argument must be a string\n");
+    RETURN_VALUE(FROM_BOOL(string_find(AS_STR(args[0]), AS_STR(args[1]), 0) >= 0));
+}
+
+static bool string_startswith(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!string_arg(args, nargs, 1))
+        RUNTIME_ERROR("string_startswith: argument must be a string\n");
+
+    string_t *s = AS_STR(args[0]);
+    string_t *prefix = AS_STR(args[1]);
+    bool starts = prefix->len <= s->len && memcmp(string_data(s), string_data(prefix), prefix->len) == 0;
+    RETURN_VALUE(FROM_BOOL(starts));
+}
+
+static bool string_endswith(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!string_arg(args, nargs, 1))
+        RUNTIME_ERROR("string_endswith: argument must be a string\n");
+
+    string_t *s = AS_STR(args[0]);
+    string_t *suffix = AS_STR(args[1]);
+    bool ends = suffix->len <= s->len &&
+        memcmp(string_data(s) + s->len - suffix->len, string_data(suffix), suffix->len) == 0;
+    RETURN_VALUE(FROM_BOOL(ends));
+}
+
+// Substrings are views into s rather than copies.
+static bool string_substring(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    string_t *s = AS_STR(args[0]);
+    uint32_t start, end;
+    if (!range_arg(args, nargs, 1, 0, s->len, &start) ||
+        !range_arg(args, nargs, 2, s->len, s->len, &end) || end < start)
+    {
+        RUNTIME_ERROR("string_substring: range out of bounds\n");
+    }
+
+    value_t str = FROM_STR(string_view(s, start, end - start));
+    vm_push_mem(vm, str);
+    RETURN_VALUE(str);
+}
+
+// Pieces of one byte come from the cached single character strings, longer
+// ones are views into the split string.
+static void split_push(vm_t *vm, array_t *parts, string_t *s, uint32_t start, uint32_t len)
+{
+    if (len == 1)
+    {
+        array_push(parts, FROM_STR(string_from_char(string_data(s)[start])));
+        return;
+    }
+
+    value_t part = FROM_STR(string_view(s, start, len));
+    vm_push_mem(vm, part);
+    array_push(parts, part);
+}
+
+// An empty separator splits the string into its characters, any other gives views into s.
+static bool string_split(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!string_arg(args, nargs, 1))
+        RUNTIME_ERROR("string_split: separator must be a string\n");
+
+    string_t *s = AS_STR(args[0]);
+    string_t *sep = AS_STR(args[1]);
+    const char *cs = string_data(s);
+    array_t *parts = array_new();
+
+    if (sep->len == 0)
+    {
+        for (uint32_t i = 0; i < s->len; i++) array_push(parts, FROM_STR(string_from_char(cs[i])));
+    }
+    else
+    {
+        uint32_t start = 0;
+        for (int32_t i = string_find(s, sep, 0); i >= 0; i = string_find(s, sep, start))
+        {
+            split_push(vm, parts, s, start, i - start);
+            start = i + sep->len;
+        }
+        split_push(vm, parts, s, start, s->len - start);
+    }
+
+    value_t v = FROM_ARRAY(parts);
+    vm_push_mem(vm, v);
+    RETURN_VALUE(v);
+}
+
+static bool string_replace_all(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!string_arg(args, nargs, 1) || !string_arg(args, nargs, 2))
+        RUNTIME_ERROR("string_replace: arguments must be strings\n");
+
+    value_t str = FROM_STR(string_replace(AS_STR(args[0]), AS_STR(args[1]), AS_STR(args[2])));
+    vm_push_mem(vm, str);
+    RETURN_VALUE(str);
+}
+
 static bool closure_name(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
 {
     value_t v = args[0];
     if (IS_CLOSURE(v))
     {
         closure_t *cl = AS_CLOSURE(v);
-        value_t name = cl->f->type == FUNC_MELON ? FROM_CSTR(cl->f->identifier) : FROM_CSTR("{native func}");
-        vm_push_mem(vm, name);
-        RETURN_VALUE(name);
+        RETURN_VALUE(cl->f->type == FUNC_MELON ? FROM_ISTR(cl->f->identifier) : FROM_ISTR("{native func}"));
     }
-    RETURN_VALUE(FROM_CSTR("undefined"));
+    RETURN_VALUE(FROM_ISTR("undefined"));
 }
 
 static bool array_new_inst(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
@@ -380,12 +556,7 @@ static bool array_new_inst(vm_t *vm, value_t *args, uint8_t nargs, uint32_t reti
 
     if (nargs > 0)
     {
-        vector_realloc(value_t, a->arr, AS_INT(args[0]));
-        a->size = AS_INT(args[0]);
-        for (uint32_t i = 0; i < a->size; i++)
-        {
-            vector_push(value_t, a->arr, FROM_NULL);
-        }
+        array_resize(a, AS_INT(args[0]));
     }
     RETURN_VALUE(v);
 }
@@ -404,7 +575,7 @@ static bool array_loadat(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx
         RUNTIME_ERROR("Array accessor out of bounds\n");
     }
 
-    value_t v = vector_get(object->arr, accessor);
+    value_t v = array_get(object, accessor);
     RETURN_VALUE(v);
 }
 
@@ -423,7 +594,7 @@ static bool array_storeat(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retid
         RUNTIME_ERROR("Array accessor out of bounds\n");
     }
 
-    vector_set(object->arr, accessor, tostore);
+    array_set(object, accessor, tostore);
     RETURN;
 }
 
@@ -451,15 +622,15 @@ static bool array_map(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
     closure_t *cl = AS_CLOSURE(args[1]);
     value_t cl_args[1];
     value_t *ret = NULL;
-    for (size_t i = 0; i < vector_size(arr->arr); i++)
+    for (uint32_t i = 0; i < arr->size; i++)
     {
-        value_t v = vector_get(arr->arr, i);
+        value_t v = array_get(arr, i);
         cl_args[0] = v;
         vm_run_closure(vm, cl, cl_args, 1, &ret);
         if (ret)
         {
             new_elements = true;
-            vector_push(value_t, new_arr->arr, *ret);
+            array_push(new_arr, *ret);
         }
     }
 
@@ -476,15 +647,137 @@ static bool array_map(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
     }
 }
 
+static bool array_slice(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    array_t *arr = AS_ARRAY(args[0]);
+    uint32_t start, end;
+    if (!range_arg(args, nargs, 1, 0, arr->size, &start) ||
+        !range_arg(args, nargs, 2, arr->size, arr->size, &end) || end < start)
+    {
+        RUNTIME_ERROR("array_slice: range out of bounds\n");
+    }
+
+    value_t v = FROM_ARRAY(array_view(arr, start, end));
+    vm_push_mem(vm, v);
+    RETURN_VALUE(v);
+}
+
+static bool array_copy(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    array_t *arr = AS_ARRAY(args[0]);
+    value_t v = FROM_ARRAY(array_view(arr, 0, arr->size));
+    vm_push_mem(vm, v);
+    RETURN_VALUE(v);
+}
+
+static bool array_concat(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs < 2 || !IS_ARRAY(args[1]))
+        RUNTIME_ERROR("array_concat: argument must be an array\n");
+
+    array_t *a = AS_ARRAY(args[0]);
+    array_t *b = AS_ARRAY(args[1]);
+    array_t *concat = array_view(a, 0, a->size);
+    array_insert_range(concat, concat->size, b, 0, b->size);
+
+    value_t v = FROM_ARRAY(concat);
+    vm_push_mem(vm, v);
+    RETURN_VALUE(v);
+}
+
+static bool array_fill(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs < 2)
+        RUNTIME_ERROR("array_fill: missing fill value\n");
+
+    array_t *arr = AS_ARRAY(args[0]);
+    uint32_t start, end;
+    if (!range_arg(args, nargs, 2, 0, arr->size, &start) ||
+        !range_arg(args, nargs, 3, arr->size, arr->size, &end))
+    {
+        RUNTIME_ERROR("array_fill: range out of bounds\n");
+    }
+
+    array_fill_range(arr, args[1], start, end);
+    RETURN_VALUE(args[0]);
+}
+
+static bool array_insert(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    array_t *arr = AS_ARRAY(args[0]);
+    uint32_t idx;
+    if (nargs < 3 || !range_arg(args, nargs, 1, 0, arr->size, &idx))
+        RUNTIME_ERROR("array_insert: expected an index in bounds and a value\n");
+
+    array_insert_value(arr, idx, args[2]);
+    RETURN_VALUE(args[0]);
+}
+
+static bool array_insert_all(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    array_t *arr = AS_ARRAY(args[0]);
+    uint32_t idx;
+    if (nargs < 3 || !range_arg(args, nargs, 1, 0, arr->size, &idx) || !IS_ARRAY(args[2]))
+        RUNTIME_ERROR("array_insert_all: expected an index in bounds and an array\n");
+
+    array_t *src = AS_ARRAY(args[2]);
+    array_insert_range(arr, idx, src, 0, src->size);
+    RETURN_VALUE(args[0]);
+}
+
+static bool array_remove(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    array_t *arr = AS_ARRAY(args[0]);
+    uint32_t idx, count;
+    if (nargs < 2 || !range_arg(args, nargs, 1, 0, arr->size, &idx) ||
+        !range_arg(args, nargs, 2, 1, arr->size, &count) || idx + count > arr->size)
+    {
+        RUNTIME_ERROR("array_remove: range out of bounds\n");
+    }
+
+    array_remove_range(arr, idx, count);
+    RETURN_VALUE(args[0]);
+}
+
+static bool array_reverse(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    array_reverse_elements(AS_ARRAY(args[0]));
+    RETURN_VALUE(args[0]);
+}
+
+static bool array_join(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs > 1 && !IS_STR(args[1]))
+        RUNTIME_ERROR("array_join: separator must be a string\n");
+
+    array_t *arr = AS_ARRAY(args[0]);
+    string_t **parts = (string_t**)malloc(sizeof(string_t*) * (arr->size + 1));
+    for (uint32_t i = 0; i < arr->size; i++)
+    {
+        value_t v = array_get(arr, i);
+        parts[i] = IS_STR(v) ? AS_STR(v) : value_to_string(vm, v);
+    }
+
+    value_t str = FROM_STR(string_join(parts, arr->size, nargs > 1 ? AS_STR(args[1]) : NULL));
+    for (uint32_t i = 0; i < arr->size; i++)
+    {
+        if (!IS_STR(array_get(arr, i))) string_free(parts[i]);
+    }
+    free(parts);
+
+    vm_push_mem(vm, str);
+    RETURN_VALUE(str);
+}
+
 static bool array_iterator(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
 {
+    array_t *a = AS_ARRAY(args[0]);
     if (nargs <= 1)
-        RETURN_VALUE(FROM_INT(0));
+        RETURN_VALUE(a->size > 0 ? FROM_INT(0) : FROM_BOOL(false));
     
     if (!IS_INT(args[1]))
         RUNTIME_ERROR("array_iterator: argument must be an int\n");
 
-    array_t *a = AS_ARRAY(args[0]);
     int next = AS_INT(args[1]) + 1;
     if (next >= a->size)
         RETURN_VALUE(FROM_BOOL(false));
@@ -497,7 +790,212 @@ static bool array_iterator_val(vm_t *vm, value_t *args, uint8_t nargs, uint32_t
     array_t *a = AS_ARRAY(args[0]);
     int idx = AS_INT(args[1]);
 
-    RETURN_VALUE(vector_get(a->arr, idx));
+    RETURN_VALUE(array_get(a, idx));
+}
+
+static value_t typedarray_get(typedarray_t *a, uint32_t idx)
+{
+    if (a->kind == TYPED_FLOAT64) return FROM_FLOAT(a->f64[idx]);
+    return FROM_INT(a->i32[idx]);
+}
+
+static bool typedarray_set(typedarray_t *a, uint32_t idx, value_t v)
+{
+    if (!IS_INT(v) && !IS_FLOAT(v)) return false;
+
+    if (a->kind == TYPED_FLOAT64) a->f64[idx] = value_to_float(v);
+    else a->i32[idx] = value_to_int(v);
+    return true;
+}
+
+static bool typedarray_new_inst(vm_t *vm, typed_e kind, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    typedarray_t *a = NULL;
+    if (nargs > 0 && IS_INT(args[0]))
+    {
+        if (AS_INT(args[0]) < 0)
+            RUNTIME_ERROR("typed array size must not be negative\n");
+        a = typedarray_new(kind, AS_INT(args[0]));
+    }
+    else if (nargs > 0 && IS_ARRAY(args[0]))
+    {
+        array_t *src = AS_ARRAY(args[0]);
+        a = typedarray_new(kind, src->size);
+        for (uint32_t i = 0; i < src->size; i++)
+        {
+            if (!typedarray_set(a, i, array_get(src, i)))
+            {
+                typedarray_free(a);
+                RUNTIME_ERROR("typed array elements must be numbers\n");
+            }
+        }
+    }
+    else if (nargs == 0)
+    {
+        a = typedarray_new(kind, 0);
+    }
+    else
+    {
+        RUNTIME_ERROR("typed array must be created from a size or an array\n");
+    }
+
+    value_t v = FROM_TYPEDARRAY(a);
+    vm_push_mem(vm, v);
+    RETURN_VALUE(v);
+}
+
+static bool float64array_new_inst(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    return typedarray_new_inst(vm, TYPED_FLOAT64, args, nargs, retidx);
+}
+
+static bool int32array_new_inst(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    return typedarray_new_inst(vm, TYPED_INT32, args, nargs, retidx);
+}
+
+static bool typedarray_loadat(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!IS_INT(args[1]))
+    {
+        RUNTIME_ERROR("Array accessor must be an int\n");
+    }
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    int accessor = AS_INT(args[1]);
+
+    if (accessor < 0 || accessor >= a->size)
+    {
+        RUNTIME_ERROR("Array accessor out of bounds\n");
+    }
+
+    RETURN_VALUE(typedarray_get(a, accessor));
+}
+
+static bool typedarray_storeat(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (!IS_INT(args[2]))
+    {
+        RUNTIME_ERROR("Array accessor must be an int\n");
+    }
+    typedarray_t *a = AS_TYPEDARRAY(args[1]);
+    int accessor = AS_INT(args[2]);
+
+    if (accessor < 0 || accessor >= a->size)
+    {
+        RUNTIME_ERROR("Array accessor out of bounds\n");
+    }
+
+    if (!typedarray_set(a, accessor, args[0]))
+    {
+        RUNTIME_ERROR("typed array elements must be numbers\n");
+    }
+    RETURN;
+}
+
+static bool typedarray_size(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    RETURN_VALUE(FROM_INT(AS_TYPEDARRAY(args[0])->size));
+}
+
+static bool typedarray_sum(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    if (a->kind == TYPED_FLOAT64)
+        RETURN_VALUE(FROM_FLOAT(vec_f64_sum(a->f64, a->size)));
+    RETURN_VALUE(FROM_INT(vec_i32_sum(a->i32, a->size)));
+}
+
+static bool typedarray_min(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    if (a->size == 0)
+        RETURN_VALUE(FROM_NULL);
+    if (a->kind == TYPED_FLOAT64)
+        RETURN_VALUE(FROM_FLOAT(vec_f64_min(a->f64, a->size)));
+    RETURN_VALUE(FROM_INT(vec_i32_min(a->i32, a->size)));
+}
+
+static bool typedarray_max(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    if (a->size == 0)
+        RETURN_VALUE(FROM_NULL);
+    if (a->kind == TYPED_FLOAT64)
+        RETURN_VALUE(FROM_FLOAT(vec_f64_max(a->f64, a->size)));
+    RETURN_VALUE(FROM_INT(vec_i32_max(a->i32, a->size)));
+}
+
+static bool typedarray_dot(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs < 2 || args[1].type != args[0].type)
+        RUNTIME_ERROR("typedarray_dot: argument must be a typed array of the same class\n");
+
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    typedarray_t *b = AS_TYPEDARRAY(args[1]);
+    if (a->size != b->size)
+        RUNTIME_ERROR("typedarray_dot: mismatched sizes %d and %d\n", a->size, b->size);
+
+    if (a->kind == TYPED_FLOAT64)
+        RETURN_VALUE(FROM_FLOAT(vec_f64_dot(a->f64, b->f64, a->size)));
+    RETURN_VALUE(FROM_INT(vec_i32_dot(a->i32, b->i32, a->size)));
+}
+
+static bool typedarray_scale(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs < 2 || (!IS_INT(args[1]) && !IS_FLOAT(args[1])))
+        RUNTIME_ERROR("typedarray_scale: argument must be a number\n");
+
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    if (a->kind == TYPED_FLOAT64) vec_f64_scale(a->f64, value_to_float(args[1]), a->size);
+    else vec_i32_scale(a->i32, value_to_int(args[1]), a->size);
+    RETURN_VALUE(args[0]);
+}
+
+static bool typedarray_add(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs < 2 || args[1].type != args[0].type)
+        RUNTIME_ERROR("typedarray_add: argument must be a typed array of the same class\n");
+
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    typedarray_t *b = AS_TYPEDARRAY(args[1]);
+    if (a->size != b->size)
+        RUNTIME_ERROR("typedarray_add: mismatched sizes %d and %d\n", a->size, b->size);
+
+    if (a->kind == TYPED_FLOAT64) vec_f64_add(a->f64, b->f64, a->size);
+    else vec_i32_add(a->i32, b->i32, a->size);
+    RETURN_VALUE(args[0]);
+}
+
+static bool typedarray_fill(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    if (nargs < 2 || (!IS_INT(args[1]) && !IS_FLOAT(args[1])))
+        RUNTIME_ERROR("typedarray_fill: argument must be a number\n");
+
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    if (a->kind == TYPED_FLOAT64) vec_f64_fill(a->f64, value_to_float(args[1]), a->size);
+    else vec_i32_fill(a->i32, value_to_int(args[1]), a->size);
+    RETURN_VALUE(args[0]);
+}
+
+static bool typedarray_iterator(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    typedarray_t *a = AS_TYPEDARRAY(args[0]);
+    if (nargs <= 1)
+        RETURN_VALUE(a->size > 0 ? FROM_INT(0) : FROM_BOOL(false));
+
+    if (!IS_INT(args[1]))
+        RUNTIME_ERROR("typedarray_iterator: argument must be an int\n");
+
+    int next = AS_INT(args[1]) + 1;
+    if (next >= a->size)
+        RETURN_VALUE(FROM_BOOL(false));
+    else
+        RETURN_VALUE(FROM_INT(next));
+}
+
+static bool typedarray_iterator_val(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    RETURN_VALUE(typedarray_get(AS_TYPEDARRAY(args[0]), AS_INT(args[1])));
 }
 
 static int sign(int val)
@@ -557,16 +1055,81 @@ static bool range_iterator_val(vm_t *vm, value_t *args, uint8_t nargs, uint32_t
 // temp stuff
 static closure_t *core_println_cl;
 static closure_t *core_print_cl;
+static closure_t *core_parse_int_cl;
+static closure_t *core_parse_float_cl;
 
 static bool core_classes_inited = false;
 static bool core_vm_inited = false;
-static bool core_semantic_inited = false;
+static void strbuilder_append_value(vm_t *vm, strbuilder_t *sb, value_t v)
+{
+    if (IS_STR(v))
+    {
+        string_t *s = AS_STR(v);
+        strbuilder_append(sb, string_data(s), s->len);
+        return;
+    }
+    if (IS_INT(v) || IS_FLOAT(v))
+    {
+        char buffer[NUMCONV_BUFFER_SIZE];
+        int len = IS_INT(v) ? num_format_int(buffer, AS_INT(v)) : num_format_double(buffer, AS_FLOAT(v));
+        strbuilder_append(sb, buffer, len);
+        return;
+    }
+    if (IS_STRBUILDER(v))
+    {
+        strbuilder_t *other = AS_STRBUILDER(v);
+        strbuilder_append(sb, other->buffer, other->len);
+        return;
+    }
 
-void core_register_semantic(symtable_t *globals)
+    string_t *s = value_to_string(vm, v);
+    strbuilder_append(sb, string_data(s), s->len);
+    string_free(s);
+}
+
+static bool strbuilder_new_inst(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    strbuilder_t *sb = strbuilder_new();
+    for (uint8_t i = 0; i < nargs; i++)
+    {
+        strbuilder_append_value(vm, sb, args[i]);
+    }
+
+    value_t v = FROM_STRBUILDER(sb);
+    vm_push_mem(vm, v);
+    RETURN_VALUE(v);
+}
+
+static bool strbuilder_append_values(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    strbuilder_t *sb = AS_STRBUILDER(args[0]);
+    for (uint8_t i = 1; i < nargs; i++)
+    {
+        strbuilder_append_value(vm, sb, args[i]);
+    }
+    RETURN_VALUE(args[0]);
+}
+
+static bool strbuilder_length(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
 {
-    if (core_semantic_inited) return;
-    core_semantic_inited = true;
+    RETURN_VALUE(FROM_INT(AS_STRBUILDER(args[0])->len));
+}
 
+static bool strbuilder_clear_contents(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    strbuilder_clear(AS_STRBUILDER(args[0]));
+    RETURN_VALUE(args[0]);
+}
+
+static bool strbuilder_tostring(vm_t *vm, value_t *args, uint8_t nargs, uint32_t retidx)
+{
+    value_t str = FROM_STR(strbuilder_to_string(AS_STRBUILDER(args[0])));
+    vm_push_mem(vm, str);
+    RETURN_VALUE(str);
+}
+
+void core_register_semantic(symtable_t *globals)
+{
     symtable_add_local(globals, "println");
     symtable_add_local(globals, "print");
 
@@ -581,6 +1144,12 @@ void core_register_semantic(symtable_t *globals)
     symtable_add_local(globals, "Instance");
     symtable_add_local(globals, "Array");
     symtable_add_local(globals, "Range");
+    symtable_add_local(globals, "Float64Array");
+    symtable_add_local(globals, "Int32Array");
+    symtable_add_local(globals, "StringBuilder");
+
+    symtable_add_local(globals, "parseInt");
+    symtable_add_local(globals, "parseFloat");
 }
 
 void core_register_vm(vm_t *vm)
@@ -605,6 +1174,15 @@ void core_register_vm(vm_t *vm)
     vm_set_global(vm, FROM_CLASS(melon_class_instance), 10);
     vm_set_global(vm, FROM_CLASS(melon_class_array), 11);
     vm_set_global(vm, FROM_CLASS(melon_class_range), 12);
+    vm_set_global(vm, FROM_CLASS(melon_class_float64array), 13);
+    vm_set_global(vm, FROM_CLASS(melon_class_int32array), 14);
+    vm_set_global(vm, FROM_CLASS(melon_class_stringbuilder), 15);
+
+    core_parse_int_cl = closure_new(function_native_new(melon_parse_int));
+    vm_set_global(vm, FROM_CLOSURE(core_parse_int_cl), PARSE_INT_SLOT);
+
+    core_parse_float_cl = closure_new(function_native_new(melon_parse_float));
+    vm_set_global(vm, FROM_CLOSURE(core_parse_float_cl), PARSE_FLOAT_SLOT);
 }
 
 void core_init_classes()
@@ -612,6 +1190,19 @@ void core_init_classes()
     if (core_classes_inited) return;
     core_classes_inited = true;
 
+    core_strings.loadf = string_intern(CORE_LOADF_STRING);
+    core_strings.loadat = string_intern(CORE_LOADAT_STRING);
+    core_strings.storef = string_intern(CORE_STOREF_STRING);
+    core_strings.storeat = string_intern(CORE_STOREAT_STRING);
+    core_strings.new = string_intern(CORE_NEW_STRING);
+    core_strings.init = string_intern(CORE_INIT_STRING);
+    core_strings.tostr = string_intern(CORE_TOSTR_STRING);
+    core_strings.add = string_intern(CORE_ADD_STRING);
+    core_strings.sub = string_intern(CORE_SUB_STRING);
+    core_strings.mul = string_intern(CORE_MUL_STRING);
+    core_strings.div = string_intern(CORE_DIV_STRING);
+    core_strings.eqeq = string_intern(CORE_EQEQ_STRING);
+
     melon_class_object = class_new(strdup("Object"), 0, NULL);
     melon_class_class = class_new(strdup("Class"), 0, NULL);
     class_set_superclass(melon_class_class, melon_class_object);
@@ -625,6 +1216,9 @@ void core_init_classes()
     melon_class_instance = class_new_with_meta(strdup("Instance"), 0, 0, melon_class_object);
     melon_class_array = class_new_with_meta(strdup("Array"), 0, 0, melon_class_object);
     melon_class_range = class_new_with_meta(strdup("Range"), 0, 0, melon_class_object);
+    melon_class_float64array = class_new_with_meta(strdup("Float64Array"), 0, 0, melon_class_object);
+    melon_class_int32array = class_new_with_meta(strdup("Int32Array"), 0, 0, melon_class_object);
+    melon_class_stringbuilder = class_new_with_meta(strdup("StringBuilder"), 0, 0, melon_class_object);
 
     class_bind(melon_class_object, "class", NATIVE_CLOSURE(object_class));
     class_bind(melon_class_object, CORE_LOADF_STRING, NATIVE_CLOSURE(object_loadfield));
@@ -645,6 +1239,14 @@ void core_init_classes()
     class_bind(melon_class_string, CORE_EQEQ_STRING, NATIVE_CLOSURE(string_equals));
     class_bind(melon_class_string, "charAt", NATIVE_CLOSURE(string_charat));
     class_bind(melon_class_string, "concat", NATIVE_CLOSURE(string_concat));
+    class_bind(melon_class_string, "indexOf", NATIVE_CLOSURE(string_indexof));
+    class_bind(melon_class_string, "lastIndexOf", NATIVE_CLOSURE(string_lastindexof));
+    class_bind(melon_class_string, "contains", NATIVE_CLOSURE(string_contains));
+    class_bind(melon_class_string, "startsWith", NATIVE_CLOSURE(string_startswith));
+    class_bind(melon_class_string, "endsWith", NATIVE_CLOSURE(string_endswith));
+    class_bind(melon_class_string, "substring", NATIVE_CLOSURE(string_substring));
+    class_bind(melon_class_string, "split", NATIVE_CLOSURE(string_split));
+    class_bind(melon_class_string, "replace", NATIVE_CLOSURE(string_replace_all));
     class_bind(melon_class_string, CORE_ADD_STRING, NATIVE_CLOSURE(string_add));
 
     class_bind(melon_class_closure, "name", NATIVE_CLOSURE(closure_name));
@@ -655,6 +1257,15 @@ void core_init_classes()
     class_bind(melon_class_array, "add", NATIVE_CLOSURE(array_add));
     class_bind(melon_class_array, "get", NATIVE_CLOSURE(array_loadat));
     class_bind(melon_class_array, "map", NATIVE_CLOSURE(array_map));
+    class_bind(melon_class_array, "slice", NATIVE_CLOSURE(array_slice));
+    class_bind(melon_class_array, "copy", NATIVE_CLOSURE(array_copy));
+    class_bind(melon_class_array, "concat", NATIVE_CLOSURE(array_concat));
+    class_bind(melon_class_array, "fill", NATIVE_CLOSURE(array_fill));
+    class_bind(melon_class_array, "insert", NATIVE_CLOSURE(array_insert));
+    class_bind(melon_class_array, "insertAll", NATIVE_CLOSURE(array_insert_all));
+    class_bind(melon_class_array, "remove", NATIVE_CLOSURE(array_remove));
+    class_bind(melon_class_array, "reverse", NATIVE_CLOSURE(array_reverse));
+    class_bind(melon_class_array, "join", NATIVE_CLOSURE(array_join));
     class_bind(melon_class_array, CORE_ITERATOR_STRING, NATIVE_CLOSURE(array_iterator));
     class_bind(melon_class_array, CORE_ITER_VAL_STRING, NATIVE_CLOSURE(array_iterator_val));
 
@@ -666,6 +1277,37 @@ void core_init_classes()
 
     class_t *range_meta = melon_class_range->metaclass;
     class_bind(range_meta, CORE_NEW_STRING, NATIVE_CLOSURE(range_new_inst));
+
+    class_t *typed_classes[2] = { melon_class_float64array, melon_class_int32array };
+    for (int i = 0; i < 2; i++)
+    {
+        class_t *c = typed_classes[i];
+        class_bind(c, CORE_LOADAT_STRING, NATIVE_CLOSURE(typedarray_loadat));
+        class_bind(c, CORE_STOREAT_STRING, NATIVE_CLOSURE(typedarray_storeat));
+        class_bind(c, "size", NATIVE_CLOSURE(typedarray_size));
+        class_bind(c, "get", NATIVE_CLOSURE(typedarray_loadat));
+        class_bind(c, "sum", NATIVE_CLOSURE(typedarray_sum));
+        class_bind(c, "min", NATIVE_CLOSURE(typedarray_min));
+        class_bind(c, "max", NATIVE_CLOSURE(typedarray_max));
+        class_bind(c, "dot", NATIVE_CLOSURE(typedarray_dot));
+        class_bind(c, "scale", NATIVE_CLOSURE(typedarray_scale));
+        class_bind(c, "add", NATIVE_CLOSURE(typedarray_add));
+        class_bind(c, "fill", NATIVE_CLOSURE(typedarray_fill));
+        class_bind(c, CORE_ITERATOR_STRING, NATIVE_CLOSURE(typedarray_iterator));
+        class_bind(c, CORE_ITER_VAL_STRING, NATIVE_CLOSURE(typedarray_iterator_val));
+    }
+
+    class_bind(melon_class_float64array->metaclass, CORE_NEW_STRING, NATIVE_CLOSURE(float64array_new_inst));
+    class_bind(melon_class_int32array->metaclass, CORE_NEW_STRING, NATIVE_CLOSURE(int32array_new_inst));
+
+    class_bind(melon_class_stringbuilder, "append", NATIVE_CLOSURE(strbuilder_append_values));
+    class_bind(melon_class_stringbuilder, "length", NATIVE_CLOSURE(strbuilder_length));
+    class_bind(melon_class_stringbuilder, "clear", NATIVE_CLOSURE(strbuilder_clear_contents));
+    class_bind(melon_class_stringbuilder, "toString", NATIVE_CLOSURE(strbuilder_tostring));
+    class_bind(melon_class_stringbuilder, CORE_TOSTR_STRING, NATIVE_CLOSURE(strbuilder_tostring));
+
+    class_t *strbuilder_meta = melon_class_stringbuilder->metaclass;
+    class_bind(strbuilder_meta, CORE_NEW_STRING, NATIVE_CLOSURE(strbuilder_new_inst));
 }
 
 void core_free_vm()
@@ -674,6 +1316,8 @@ void core_free_vm()
 
     closure_free(core_println_cl);
     closure_free(core_print_cl);
+    closure_free(core_parse_int_cl);
+    closure_free(core_parse_float_cl);
 }
 
 void core_free_classes()
@@ -692,4 +1336,9 @@ void core_free_classes()
     class_free(melon_class_instance);
     class_free(melon_class_array);
     class_free(melon_class_range);
+    class_free(melon_class_float64array);
+    class_free(melon_class_int32array);
+    class_free(melon_class_stringbuilder);
+
+    string_intern_free();
 }
\ No newline at end of file
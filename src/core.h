@@ -20,7 +20,30 @@
 #define CORE_DIV_STRING "$div"
 #define CORE_EQEQ_STRING "$eqeq"
 
+// Interned names the vm looks up while dispatching, created by core_init_classes.
+typedef struct
+{
+    string_t *loadf;
+    string_t *loadat;
+    string_t *storef;
+    string_t *storeat;
+    string_t *new;
+    string_t *init;
+    string_t *tostr;
+    string_t *add;
+    string_t *sub;
+    string_t *mul;
+    string_t *div;
+    string_t *eqeq;
+} core_strings_t;
+
+extern core_strings_t core_strings;
+
+// Globals declared by core_register_semantic, they take the first slots of every module.
+#define CORE_NGLOBALS 18
+
 void core_register_semantic(symtable_t *globals);
+string_t *core_value_to_string(vm_t *vm, value_t v);
 void core_register_vm(vm_t *vm);
 
 void core_init_classes();
@@ -26,6 +26,7 @@ const char *op_to_str(opcode op)
     case OP_CLOSURE: return "closure";
     case OP_CLOSE: return "close";
     case OP_CALL: return "call";
+    case OP_INVOKE: return "invoke";
     case OP_JMP: return "jmp";
     case OP_LOOP: return "loop";
     case OP_JIF: return "jif";
@@ -48,11 +49,50 @@ const char *op_to_str(opcode op)
     case OP_EQ: return "eq";
     case OP_NEQ: return "neq";
 
+    case OP_ADD_II: return "add_ii";
+    case OP_SUB_II: return "sub_ii";
+    case OP_MUL_II: return "mul_ii";
+    case OP_DIV_II: return "div_ii";
+    case OP_MOD_II: return "mod_ii";
+    case OP_LT_II: return "lt_ii";
+    case OP_GT_II: return "gt_ii";
+    case OP_LTE_II: return "lte_ii";
+    case OP_GTE_II: return "gte_ii";
+    case OP_EQ_II: return "eq_ii";
+    case OP_NEQ_II: return "neq_ii";
+    case OP_ADD_FF: return "add_ff";
+    case OP_SUB_FF: return "sub_ff";
+    case OP_MUL_FF: return "mul_ff";
+    case OP_DIV_FF: return "div_ff";
+    case OP_LT_FF: return "lt_ff";
+    case OP_GT_FF: return "gt_ff";
+    case OP_LTE_FF: return "lte_ff";
+    case OP_GTE_FF: return "gte_ff";
+    case OP_EQ_FF: return "eq_ff";
+    case OP_NEQ_FF: return "neq_ff";
+
     case OP_NEWARR: return "newarr";
     case OP_NEWRNG: return "newrng";
+    case OP_CONCAT: return "concat";
 
     case OP_HALT: return "halt";
     }
     printf("Unrecognized op %d\n", op);
     return "";
+}
+
+// Size of the instruction in bytes, including its operands.
+uint8_t op_length(opcode op)
+{
+    switch (op)
+    {
+    case OP_LOADI: case OP_STOREL: case OP_LOADL: case OP_JIF: case OP_JMP:
+    case OP_LOOP: case OP_LOADK: case OP_LOADG: case OP_STOREG: case OP_CALL:
+    case OP_LOADU: case OP_STOREU: case OP_LOADF: case OP_NEWARR: case OP_CONCAT:
+        return 2;
+    case OP_NEWUP: case OP_INVOKE:
+        return 3;
+    default:
+        return 1;
+    }
 }
\ No newline at end of file
@@ -5,5 +5,6 @@
 #include "codegen.h"
 
 const char *op_to_str(opcode op);
+uint8_t op_length(opcode op);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "fold.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "astwalker.h"
+#include "numconv.h"
+
+#define IS_LITERAL(n, _type) ((n)->type == NODE_LITERAL && ((node_literal_t*)(n))->type == (_type))
+
+static void fold(astwalker_t *self, node_t **slot);
+
+static bool is_number(node_t *node)
+{
+    return IS_LITERAL(node, LITERAL_INT) || IS_LITERAL(node, LITERAL_FLT);
+}
+
+static double literal_float(node_literal_t *lit)
+{
+    return lit->type == LITERAL_INT ? (double)lit->u.i : lit->u.d;
+}
+
+// Returns the text the vm produces when converting the literal to a string,
+// buffer must hold NUMCONV_BUFFER_SIZE bytes.
+static const char *literal_text(node_literal_t *lit, char *buffer, int *len)
+{
+    switch (lit->type)
+    {
+    case LITERAL_STR: *len = lit->str_size; return lit->u.s;
+    case LITERAL_INT: *len = num_format_int(buffer, lit->u.i); return buffer;
+    case LITERAL_FLT: *len = num_format_double(buffer, lit->u.d); return buffer;
+    case LITERAL_BOOL:
+        *len = lit->u.i ? 4 : 5;
+        return lit->u.i ? "true" : "false";
+    }
+    *len = 0;
+    return "";
+}
+
+static node_t *literal_str_concat(node_literal_t *a, node_literal_t *b)
+{
+    char abuf[NUMCONV_BUFFER_SIZE], bbuf[NUMCONV_BUFFER_SIZE];
+    int alen, blen;
+    const char *as = literal_text(a, abuf, &alen);
+    const char *bs = literal_text(b, bbuf, &blen);
+
+    char *s = (char*)arena_alloc(ast_arena(), alen + blen + 1);
+    memcpy(s, as, alen);
+    memcpy(s + alen, bs, blen);
+    s[alen + blen] = '\0';
+    return node_literal_str_new(s, alen + blen);
+}
+
+// Mirrors DO_FAST_BIN_MATH and DO_FAST_CMP_MATH: ints stay ints and wrap,
+// an int mixed with a float is promoted. Expressions that trap at run time,
+// like an integer division by zero, are left alone.
+static node_t *fold_numbers(token_type op, node_literal_t *a, node_literal_t *b)
+{
+    if (a->type == LITERAL_INT && b->type == LITERAL_INT)
+    {
+        int x = a->u.i, y = b->u.i;
+        switch (op)
+        {
+        case TOK_ADD: return node_literal_int_new((int)((uint32_t)x + (uint32_t)y));
+        case TOK_SUB: return node_literal_int_new((int)((uint32_t)x - (uint32_t)y));
+        case TOK_MUL: return node_literal_int_new((int)((uint32_t)x * (uint32_t)y));
+        case TOK_DIV:
+        case TOK_MOD:
+            if (y == 0 || (x == INT_MIN && y == -1)) return NULL;
+            return node_literal_int_new(op == TOK_DIV ? x / y : x % y);
+        case TOK_LT: return node_literal_bool_new(x < y);
+        case TOK_GT: return node_literal_bool_new(x > y);
+        case TOK_LTE: return node_literal_bool_new(x <= y);
+        case TOK_GTE: return node_literal_bool_new(x >= y);
+        case TOK_EQEQ: return node_literal_bool_new(x == y);
+        case TOK_NEQ: return node_literal_bool_new(x != y);
+        default: return NULL;
+        }
+    }
+
+    double x = literal_float(a), y = literal_float(b);
+    switch (op)
+    {
+    case TOK_ADD: return node_literal_float_new(x + y);
+    case TOK_SUB: return node_literal_float_new(x - y);
+    case TOK_MUL: return node_literal_float_new(x * y);
+    case TOK_DIV: return node_literal_float_new(x / y);
+    case TOK_LT: return node_literal_bool_new(x < y);
+    case TOK_GT: return node_literal_bool_new(x > y);
+    case TOK_LTE: return node_literal_bool_new(x <= y);
+    case TOK_GTE: return node_literal_bool_new(x >= y);
+    case TOK_EQEQ: return node_literal_bool_new(x == y);
+    case TOK_NEQ: return node_literal_bool_new(x != y);
+    default: return NULL;
+    }
+}
+
+static node_t *fold_binary_literals(node_binary_t *node)
+{
+    if (node->left->type != NODE_LITERAL || node->right->type != NODE_LITERAL) return NULL;
+
+    node_literal_t *a = (node_literal_t*)node->left;
+    node_literal_t *b = (node_literal_t*)node->right;
+    token_type op = node->op.type;
+
+    if (op == TOK_ADD && (a->type == LITERAL_STR || b->type == LITERAL_STR))
+        return literal_str_concat(a, b);
+
+    if (is_number(node->left) && is_number(node->right))
+        return fold_numbers(op, a, b);
+
+    if (a->type == LITERAL_BOOL && b->type == LITERAL_BOOL)
+    {
+        if (op == TOK_AND) return node_literal_bool_new(a->u.i && b->u.i);
+        if (op == TOK_OR) return node_literal_bool_new(a->u.i || b->u.i);
+    }
+
+    return NULL;
+}
+
+static node_t *fold_unary_literal(node_unary_t *node)
+{
+    if (node->right->type != NODE_LITERAL) return NULL;
+
+    node_literal_t *lit = (node_literal_t*)node->right;
+    if (node->op.type == TOK_BANG && lit->type == LITERAL_BOOL)
+        return node_literal_bool_new(!lit->u.i);
+    if (node->op.type == TOK_SUB && lit->type == LITERAL_INT)
+        return node_literal_int_new((int)(0u - (uint32_t)lit->u.i));
+    if (node->op.type == TOK_SUB && lit->type == LITERAL_FLT)
+        return node_literal_float_new(-lit->u.d);
+
+    return NULL;
+}
+
+// Merges each run of literal parts into one string literal. A template made
+// only of literals becomes a plain string.
+static node_t *fold_concat_literals(node_concat_t *node)
+{
+    node_r *parts = node->parts;
+    size_t count = 0;
+    vector_t(char) text;
+    vector_init(text);
+
+    for (size_t i = 0; i <= vector_size(*parts); i++)
+    {
+        node_t *part = i < vector_size(*parts) ? vector_get(*parts, i) : NULL;
+        if (part && part->type == NODE_LITERAL)
+        {
+            char buffer[NUMCONV_BUFFER_SIZE];
+            int len;
+            const char *s = literal_text((node_literal_t*)part, buffer, &len);
+            for (int j = 0; j < len; j++) vector_push(char, text, s[j]);
+            continue;
+        }
+
+        if (vector_size(text) > 0)
+        {
+            int len = vector_size(text);
+            vector_get(*parts, count++) = node_literal_str_new(arena_strndup(ast_arena(), text.a, len), len);
+            text.n = 0;
+        }
+        if (part) vector_get(*parts, count++) = part;
+    }
+    parts->n = count;
+    vector_destroy(text);
+
+    if (count == 1 && IS_LITERAL(vector_get(*parts, 0), LITERAL_STR))
+    {
+        node_t *literal = vector_get(*parts, 0);
+        vector_popn(*parts, 1);
+        return literal;
+    }
+    if (count == 0) return node_literal_str_new(arena_strdup(ast_arena(), ""), 0);
+    return NULL;
+}
+
+static void fold_nodes(astwalker_t *self, node_r *nodes)
+{
+    if (!nodes) return;
+    for (size_t i = 0; i < vector_size(*nodes); i++)
+    {
+        fold(self, &vector_get(*nodes, i));
+    }
+}
+
+static void fold_block(astwalker_t *self, node_block_t *node)
+{
+    fold_nodes(self, node->stmts);
+}
+
+static void fold_if(astwalker_t *self, node_if_t *node)
+{
+    fold(self, &node->cond);
+    fold(self, &node->then);
+    fold(self, &node->els);
+}
+
+static void fold_loop(astwalker_t *self, node_loop_t *node)
+{
+    fold(self, &node->init);
+    fold(self, &node->cond);
+    fold(self, &node->inc);
+    fold(self, &node->body);
+}
+
+static void fold_return(astwalker_t *self, node_return_t *node)
+{
+    fold(self, &node->expr);
+}
+
+static void fold_var_decl(astwalker_t *self, node_var_decl_t *node)
+{
+    fold(self, &node->init);
+}
+
+static void fold_func_decl(astwalker_t *self, node_func_decl_t *node)
+{
+    if (node->body) walk_ast(self, (node_t*)node->body);
+}
+
+static void fold_class_decl(astwalker_t *self, node_class_decl_t *node)
+{
+    fold_nodes(self, node->decls);
+}
+
+static void fold_binary(astwalker_t *self, node_binary_t *node)
+{
+    fold(self, &node->left);
+    fold(self, &node->right);
+}
+
+static void fold_unary(astwalker_t *self, node_unary_t *node)
+{
+    fold(self, &node->right);
+}
+
+static void fold_postfix(astwalker_t *self, node_postfix_t *node)
+{
+    fold(self, &node->target);
+    if (!node->exprs) return;
+
+    for (size_t i = 0; i < vector_size(*node->exprs); i++)
+    {
+        postfix_expr_t *expr = vector_get(*node->exprs, i);
+        if (expr->type == POST_CALL) fold_nodes(self, expr->args);
+        else if (expr->type == POST_SUBSCRIPT) fold(self, &expr->accessor);
+    }
+}
+
+static void fold_list(astwalker_t *self, node_list_t *node)
+{
+    fold_nodes(self, node->items);
+}
+
+static void fold_range(astwalker_t *self, node_range_t *node)
+{
+    fold(self, &node->start);
+    fold(self, &node->end);
+}
+
+static void fold_concat(astwalker_t *self, node_concat_t *node)
+{
+    fold_nodes(self, node->parts);
+}
+
+// Folds the children of *slot first, then replaces *slot itself if it became
+// an operation on literals.
+static void fold(astwalker_t *self, node_t **slot)
+{
+    node_t *node = *slot;
+    if (!node) return;
+    walk_ast(self, node);
+
+    node_t *folded = NULL;
+    if (node->type == NODE_BINARY && ((node_binary_t*)node)->op.type != TOK_EQ)
+        folded = fold_binary_literals((node_binary_t*)node);
+    else if (node->type == NODE_UNARY)
+        folded = fold_unary_literal((node_unary_t*)node);
+    else if (node->type == NODE_CONCAT)
+        folded = fold_concat_literals((node_concat_t*)node);
+
+    if (!folded) return;
+
+    folded->token = node->token;
+    *slot = folded;
+}
+
+void fold_process(node_t *ast)
+{
+    astwalker_t walker = {
+        .visit_block = fold_block,
+        .visit_if = fold_if,
+        .visit_loop = fold_loop,
+        .visit_return = fold_return,
+
+        .visit_var_decl = fold_var_decl,
+        .visit_func_decl = fold_func_decl,
+        .visit_class_decl = fold_class_decl,
+
+        .visit_binary = fold_binary,
+        .visit_unary = fold_unary,
+        .visit_postfix = fold_postfix,
+        .visit_var = NULL,
+        .visit_list = fold_list,
+        .visit_range = fold_range,
+        .visit_literal = NULL,
+        .visit_concat = fold_concat
+    };
+    walk_ast(&walker, ast);
+}
\ No newline at end of file
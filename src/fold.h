@@ -0,0 +1,10 @@
+#ifndef __FOLD__
+#define __FOLD__
+
+#include "ast.h"
+
+// Replaces operations on literals with their result, so the generated code
+// never evaluates constant expressions at run time. Runs on the linked program.
+void fold_process(node_t *ast);
+
+#endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "hash.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #define HASH_SEED 4759
 
@@ -10,11 +11,13 @@ uint32_t murmur3_32(const uint8_t *key, size_t len, uint32_t seed)
     uint32_t h = seed;
     if (len > 3)
     {
-        const uint32_t *key_x4 = (const uint32_t*)key;
         size_t i = len >> 2;
         do
         {
-            uint32_t k = *key_x4++;
+            // keys can start anywhere, such as inside a mapped bytecode file
+            uint32_t k;
+            memcpy(&k, key, sizeof(k));
+            key += sizeof(k);
             k *= 0xcc9e2d51;
             k = (k << 15) | (k >> 17);
             k *= 0x1b873593;
@@ -22,7 +25,6 @@ uint32_t murmur3_32(const uint8_t *key, size_t len, uint32_t seed)
             h = (h << 13) | (h >> 19);
             h += (h << 2) + 0xe6546b64;
         } while (--i);
-        key = (const uint8_t*)key_x4;
     }
     if (len & 3)
     {
@@ -106,31 +108,44 @@ uint32_t hash_string(const char *s)
     return murmur3_32((const uint8_t*)s, strlen(s), HASH_SEED);
 }
 
+uint32_t hash_bytes(const char *s, uint32_t len)
+{
+    return murmur3_32((const uint8_t*)s, len, HASH_SEED);
+}
+
 static uint32_t hash_value(value_t v)
 {
     if (IS_STR(v))
     {
-        return AS_STR(v)->hash;
+        return string_hash(AS_STR(v));
     }
     // Not implemented if v is not a string.
     return 0;
 }
 
+// String keys are interned, so chains compare them by pointer.
+static bool keys_equal(value_t k1, value_t k2)
+{
+    if (IS_STR(k1)) return k1.type == k2.type && k1.o == k2.o;
+    return value_equals(k1, k2);
+}
+
 void hashtable_set(hashtable_t *htable, value_t key, value_t value)
 {
+    if (IS_STR(key)) key.o = string_intern_str(AS_STR(key));
     uint32_t bin = hash_value(key) % htable->size;
 
     hash_entry_t *last = NULL;
     hash_entry_t *newpair = NULL;
     hash_entry_t *next = htable->table[bin];
 
-    while (next != NULL && !value_equals(key, next->key))
+    while (next != NULL && !keys_equal(key, next->key))
     {
         last = next;
         next = next->next;
     }
 
-    if (next != NULL && value_equals(key, next->key))
+    if (next != NULL && keys_equal(key, next->key))
     {
         next->value = value;
     }
@@ -157,15 +172,21 @@ void hashtable_set(hashtable_t *htable, value_t key, value_t value)
 
 value_t *hashtable_get(hashtable_t *htable, value_t key)
 {
+    if (IS_STR(key))
+    {
+        // a string that was never interned cannot be a key of any table
+        key.o = string_intern_find(AS_STR(key));
+        if (!key.o) return NULL;
+    }
     uint32_t bin = hash_value(key) % htable->size;
 
     hash_entry_t *node = htable->table[bin];
-    while (node != NULL && !value_equals(key, node->key))
+    while (node != NULL && !keys_equal(key, node->key))
     {
         node = node->next;
     }
 
-    if (node == NULL || !value_equals(key, node->key))
+    if (node == NULL || !keys_equal(key, node->key))
     {
         return NULL;
     }
@@ -0,0 +1,442 @@
+#include "inliner.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "astwalker.h"
+
+#define MAX_GLOBAL_SLOTS 256
+
+typedef struct
+{
+    uint32_t budget;
+    bool substitute;
+
+    // a function can only be inlined if its global slot is written exactly once
+    uint16_t writes[MAX_GLOBAL_SLOTS];
+    node_func_decl_t *candidates[MAX_GLOBAL_SLOTS];
+
+    // a global function exists once the top level statement declaring it has
+    // run, so only calls in later top level statements are replaced
+    uint32_t declared_at[MAX_GLOBAL_SLOTS];
+    uint32_t stmt;
+    node_t *root_stmt;
+
+    // the class whose declarations are being visited
+    node_class_decl_t *class;
+} inliner_t;
+
+#define INLINER ((inliner_t*)self->data)
+
+static void inline_slot(astwalker_t *self, node_t **slot);
+
+static uint8_t func_nparams(node_func_decl_t *func)
+{
+    return func->params ? vector_size(*func->params) : 0;
+}
+
+// Methods take their object in local 0, their parameters follow it.
+static uint8_t func_first_param(node_func_decl_t *func)
+{
+    return func->parent && func->parent->loc == LOC_CLASS ? 1 : 0;
+}
+
+// Counts the nodes of an expression built only from literals, operators,
+// parameter and global reads, and for methods reads of their class
+// variables, or returns -1 if it contains anything else.
+static int inlinable_size(node_t *node, node_func_decl_t *func)
+{
+    switch (node->type)
+    {
+    case NODE_LITERAL: return 1;
+    case NODE_VAR:
+    {
+        node_var_t *var = (node_var_t*)node;
+        uint8_t first = func_first_param(func);
+        if (var->location == LOC_GLOBAL) return 1;
+        if (var->location == LOC_CLASS) return first ? 1 : -1;
+        return var->location == LOC_LOCAL && var->idx >= first && var->idx < first + func_nparams(func) ? 1 : -1;
+    }
+    case NODE_BINARY:
+    {
+        node_binary_t *binary = (node_binary_t*)node;
+        if (binary->op.type == TOK_EQ) return -1;
+        int left = inlinable_size(binary->left, func);
+        int right = inlinable_size(binary->right, func);
+        return left < 0 || right < 0 ? -1 : left + right + 1;
+    }
+    case NODE_UNARY:
+    {
+        int right = inlinable_size(((node_unary_t*)node)->right, func);
+        return right < 0 ? -1 : right + 1;
+    }
+    case NODE_CONCAT:
+    {
+        node_r *parts = ((node_concat_t*)node)->parts;
+        int size = 1;
+        for (size_t i = 0; i < vector_size(*parts); i++)
+        {
+            int part = inlinable_size(vector_get(*parts, i), func);
+            if (part < 0) return -1;
+            size += part;
+        }
+        return size;
+    }
+    default: return -1;
+    }
+}
+
+static node_t *inline_body(node_func_decl_t *func, uint32_t budget)
+{
+    node_r *stmts = func->body->stmts;
+    if (!stmts || vector_size(*stmts) != 1) return NULL;
+
+    node_t *stmt = vector_get(*stmts, 0);
+    if (!stmt || stmt->type != NODE_RETURN) return NULL;
+
+    node_t *expr = ((node_return_t*)stmt)->expr;
+    if (!expr) return NULL;
+
+    int size = inlinable_size(expr, func);
+    return size > 0 && (uint32_t)size <= budget ? expr : NULL;
+}
+
+// Arguments are substituted for every use of their parameter, possibly more
+// than once or not at all, so they must be free of side effects.
+static bool is_pure_arg(node_t *node)
+{
+    return node->type == NODE_LITERAL || node->type == NODE_VAR;
+}
+
+// A variable argument is read where its parameter is used rather than before
+// the call, and an operator of the body may run an overload that assigns it.
+// Its parameter must therefore be used at most once, before any operator runs.
+static bool args_read_in_order(node_t *node, node_r *args, uint8_t first, uint8_t *uses, bool *operated)
+{
+    switch (node->type)
+    {
+    case NODE_VAR:
+    {
+        node_var_t *var = (node_var_t*)node;
+        if (var->location != LOC_LOCAL || vector_get(*args, var->idx - first)->type != NODE_VAR) return true;
+        return uses[var->idx - first]++ == 0 && !*operated;
+    }
+    case NODE_BINARY:
+    {
+        node_binary_t *binary = (node_binary_t*)node;
+        if (!args_read_in_order(binary->left, args, first, uses, operated)) return false;
+        if (!args_read_in_order(binary->right, args, first, uses, operated)) return false;
+        *operated = true;
+        return true;
+    }
+    case NODE_UNARY:
+        if (!args_read_in_order(((node_unary_t*)node)->right, args, first, uses, operated)) return false;
+        *operated = true;
+        return true;
+    case NODE_CONCAT:
+    {
+        node_r *parts = ((node_concat_t*)node)->parts;
+        for (size_t i = 0; i < vector_size(*parts); i++)
+        {
+            if (!args_read_in_order(vector_get(*parts, i), args, first, uses, operated)) return false;
+        }
+        *operated = true;
+        return true;
+    }
+    default: return true;
+    }
+}
+
+static node_t *clone_expr(node_t *node, node_r *args, uint8_t first)
+{
+    switch (node->type)
+    {
+    case NODE_LITERAL:
+    {
+        node_literal_t *lit = (node_literal_t*)node;
+        node_t *copy = NULL;
+        if (lit->type == LITERAL_INT) copy = node_literal_int_new(lit->u.i);
+        else if (lit->type == LITERAL_FLT) copy = node_literal_float_new(lit->u.d);
+        else if (lit->type == LITERAL_BOOL) copy = node_literal_bool_new(lit->u.i);
+        else
+        {
+            copy = node_literal_str_new(arena_strndup(ast_arena(), lit->u.s, lit->str_size), lit->str_size);
+        }
+        copy->token = node->token;
+        return copy;
+    }
+    case NODE_VAR:
+    {
+        node_var_t *var = (node_var_t*)node;
+        if (args && var->location == LOC_LOCAL) return clone_expr(vector_get(*args, var->idx - first), NULL, 0);
+
+        node_var_t *copy = (node_var_t*)node_var_new(node->token, arena_strdup(ast_arena(), var->identifier));
+        copy->idx = var->idx;
+        copy->location = var->location;
+        return (node_t*)copy;
+    }
+    case NODE_BINARY:
+    {
+        node_binary_t *binary = (node_binary_t*)node;
+        node_binary_t *copy = (node_binary_t*)node_binary_new(binary->op,
+            clone_expr(binary->left, args, first), clone_expr(binary->right, args, first));
+        copy->operands = binary->operands;
+        return (node_t*)copy;
+    }
+    case NODE_UNARY:
+    {
+        node_unary_t *unary = (node_unary_t*)node;
+        node_t *copy = node_unary_new(unary->op, clone_expr(unary->right, args, first));
+        copy->token = node->token;
+        return copy;
+    }
+    case NODE_CONCAT:
+    {
+        node_r *parts = ((node_concat_t*)node)->parts;
+        node_r *copies = (node_r*)arena_alloc(ast_arena(), sizeof(node_r));
+        for (size_t i = 0; i < vector_size(*parts); i++)
+        {
+            vector_push_arena(node_t*, *copies, clone_expr(vector_get(*parts, i), args, first), ast_arena());
+        }
+        node_t *copy = node_concat_new(copies);
+        copy->token = node->token;
+        return copy;
+    }
+    default: return NULL;
+    }
+}
+
+// Methods of a final class are never reassigned, so a call bound to one
+// directly always runs the method declared in the class.
+static node_func_decl_t *final_method(node_class_decl_t *c, node_var_t *var)
+{
+    for (size_t i = 0; i < vector_size(*c->decls); i++)
+    {
+        node_var_decl_t *decl = (node_var_decl_t*)vector_get(*c->decls, i);
+        if (decl->base.type == NODE_VAR_DECL && decl->idx == var->idx && strcmp(decl->ident, var->identifier) == 0)
+        {
+            return decl->init && decl->init->type == NODE_FUNC_DECL ? (node_func_decl_t*)decl->init : NULL;
+        }
+    }
+    return NULL;
+}
+
+static node_func_decl_t *call_target(astwalker_t *self, node_postfix_t *node, node_var_t *target)
+{
+    if (node->binding == BIND_DIRECT) return INLINER->class ? final_method(INLINER->class, target) : NULL;
+    if (target->location != LOC_GLOBAL || node->binding != BIND_NONE) return NULL;
+
+    if (INLINER->writes[target->idx] != 1 || INLINER->declared_at[target->idx] >= INLINER->stmt) return NULL;
+    return INLINER->candidates[target->idx];
+}
+
+// Returns the inlined body if node is a call of a candidate with pure arguments.
+static node_t *inline_call(astwalker_t *self, node_postfix_t *node)
+{
+    if (node->target->type != NODE_VAR || !node->exprs || vector_size(*node->exprs) != 1) return NULL;
+
+    node_var_t *target = (node_var_t*)node->target;
+    postfix_expr_t *call = vector_get(*node->exprs, 0);
+    if (call->type != POST_CALL) return NULL;
+
+    node_func_decl_t *func = call_target(self, node, target);
+    if (!func) return NULL;
+
+    uint8_t nargs = call->args ? vector_size(*call->args) : 0;
+    if (nargs != func_nparams(func)) return NULL;
+    for (uint8_t i = 0; i < nargs; i++)
+    {
+        if (!is_pure_arg(vector_get(*call->args, i))) return NULL;
+    }
+
+    node_t *body = inline_body(func, INLINER->budget);
+    if (!body) return NULL;
+
+    uint8_t uses[256] = { 0 };
+    bool operated = false;
+    if (nargs > 0 && !args_read_in_order(body, call->args, func_first_param(func), uses, &operated)) return NULL;
+    return clone_expr(body, call->args, func_first_param(func));
+}
+
+static void global_write(astwalker_t *self, location_e loc, uint8_t idx)
+{
+    if (loc == LOC_GLOBAL && INLINER->writes[idx] < UINT16_MAX) INLINER->writes[idx]++;
+}
+
+static void inline_nodes(astwalker_t *self, node_r *nodes)
+{
+    if (!nodes) return;
+    for (size_t i = 0; i < vector_size(*nodes); i++)
+    {
+        inline_slot(self, &vector_get(*nodes, i));
+    }
+}
+
+static void inline_block(astwalker_t *self, node_block_t *node)
+{
+    if (!node->is_root)
+    {
+        inline_nodes(self, node->stmts);
+        return;
+    }
+
+    for (size_t i = 0; i < vector_size(*node->stmts); i++)
+    {
+        INLINER->stmt = i + 1;
+        INLINER->root_stmt = vector_get(*node->stmts, i);
+        inline_slot(self, &vector_get(*node->stmts, i));
+    }
+}
+
+static void inline_if(astwalker_t *self, node_if_t *node)
+{
+    inline_slot(self, &node->cond);
+    inline_slot(self, &node->then);
+    inline_slot(self, &node->els);
+}
+
+static void inline_loop(astwalker_t *self, node_loop_t *node)
+{
+    inline_slot(self, &node->init);
+    inline_slot(self, &node->cond);
+    inline_slot(self, &node->inc);
+    inline_slot(self, &node->body);
+
+    if (node->type == LOOP_FORIN && !INLINER->substitute)
+    {
+        global_write(self, node->loc, node->target_idx);
+        global_write(self, node->loc, node->it_idx);
+    }
+}
+
+static void inline_return(astwalker_t *self, node_return_t *node)
+{
+    inline_slot(self, &node->expr);
+}
+
+static void inline_var_decl(astwalker_t *self, node_var_decl_t *node)
+{
+    inline_slot(self, &node->init);
+    if (INLINER->substitute) return;
+
+    global_write(self, node->loc, node->idx);
+    if (node->loc == LOC_GLOBAL && (node_t*)node == INLINER->root_stmt && node->init && node->init->type == NODE_FUNC_DECL)
+    {
+        node_func_decl_t *func = (node_func_decl_t*)node->init;
+        if (inline_body(func, INLINER->budget))
+        {
+            INLINER->candidates[node->idx] = func;
+            INLINER->declared_at[node->idx] = INLINER->stmt;
+        }
+    }
+}
+
+static void inline_func_decl(astwalker_t *self, node_func_decl_t *node)
+{
+    if (node->body) walk_ast(self, (node_t*)node->body);
+}
+
+static void inline_class_decl(astwalker_t *self, node_class_decl_t *node)
+{
+    if (!INLINER->substitute) global_write(self, node->loc, node->idx);
+
+    INLINER->class = node;
+    inline_nodes(self, node->decls);
+    INLINER->class = NULL;
+}
+
+static void inline_binary(astwalker_t *self, node_binary_t *node)
+{
+    inline_slot(self, &node->left);
+    inline_slot(self, &node->right);
+
+    if (!INLINER->substitute && node->op.type == TOK_EQ && node->left->type == NODE_VAR)
+    {
+        node_var_t *var = (node_var_t*)node->left;
+        global_write(self, var->location, var->idx);
+    }
+}
+
+static void inline_unary(astwalker_t *self, node_unary_t *node)
+{
+    inline_slot(self, &node->right);
+}
+
+static void inline_postfix(astwalker_t *self, node_postfix_t *node)
+{
+    inline_slot(self, &node->target);
+    if (!node->exprs) return;
+
+    for (size_t i = 0; i < vector_size(*node->exprs); i++)
+    {
+        postfix_expr_t *expr = vector_get(*node->exprs, i);
+        if (expr->type == POST_CALL) inline_nodes(self, expr->args);
+        else if (expr->type == POST_SUBSCRIPT) inline_slot(self, &expr->accessor);
+    }
+}
+
+static void inline_list(astwalker_t *self, node_list_t *node)
+{
+    inline_nodes(self, node->items);
+}
+
+static void inline_range(astwalker_t *self, node_range_t *node)
+{
+    inline_slot(self, &node->start);
+    inline_slot(self, &node->end);
+}
+
+static void inline_concat(astwalker_t *self, node_concat_t *node)
+{
+    inline_nodes(self, node->parts);
+}
+
+static void inline_slot(astwalker_t *self, node_t **slot)
+{
+    node_t *node = *slot;
+    if (!node) return;
+    walk_ast(self, node);
+
+    if (!INLINER->substitute || node->type != NODE_POSTFIX) return;
+
+    node_t *inlined = inline_call(self, (node_postfix_t*)node);
+    if (!inlined) return;
+
+    *slot = inlined;
+}
+
+void inline_process(node_t *ast, uint32_t budget)
+{
+    if (budget == 0) return;
+
+    inliner_t *inliner = (inliner_t*)calloc(1, sizeof(inliner_t));
+    inliner->budget = budget;
+
+    astwalker_t walker = {
+        .data = (void*)inliner,
+
+        .visit_block = inline_block,
+        .visit_if = inline_if,
+        .visit_loop = inline_loop,
+        .visit_return = inline_return,
+
+        .visit_var_decl = inline_var_decl,
+        .visit_func_decl = inline_func_decl,
+        .visit_class_decl = inline_class_decl,
+
+        .visit_binary = inline_binary,
+        .visit_unary = inline_unary,
+        .visit_postfix = inline_postfix,
+        .visit_var = NULL,
+        .visit_list = inline_list,
+        .visit_range = inline_range,
+        .visit_literal = NULL,
+        .visit_concat = inline_concat
+    };
+
+    walk_ast(&walker, ast);
+    inliner->substitute = true;
+    walk_ast(&walker, ast);
+
+    free(inliner);
+}
\ No newline at end of file
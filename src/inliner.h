@@ -0,0 +1,20 @@
+#ifndef __INLINER__
+#define __INLINER__
+
+#include <stdint.h>
+
+#include "ast.h"
+
+#define INLINE_DEFAULT_BUDGET 24
+
+// Replaces calls to small global functions, and calls between the methods
+// of a final class, with a copy of their body. Only functions whose body is
+// a single `return <expr>;` over their parameters, globals, literals and, for
+// methods, the variables of their class qualify, when the expression has at
+// most budget nodes and a global function is never reassigned. Only calls in
+// top level statements after the declaration are replaced, earlier ones
+// still fail at run time. A budget of 0 disables inlining. Runs on the
+// linked program.
+void inline_process(node_t *ast, uint32_t budget);
+
+#endif
\ No newline at end of file
@@ -1,53 +1,139 @@
 #include "lexer.h"
 
 #include <stdio.h>
-#include <ctype.h>
+#include <string.h>
 
-#include "vector.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LEXER_SSE2
+#endif
+
+typedef enum
+{
+    CC_NONE, CC_SPACE, CC_IDENT, CC_DIGIT, CC_PUNC, CC_OP, CC_QUOTE, CC_TEMPLATE, CC_COMMENT
+} char_class;
+
+#define _ CC_NONE
+#define S CC_SPACE
+#define I CC_IDENT
+#define D CC_DIGIT
+#define P CC_PUNC
+#define O CC_OP
+#define Q CC_QUOTE
+#define T CC_TEMPLATE
+#define C CC_COMMENT
+
+// Class of every byte; non-ascii bytes are CC_NONE.
+static const uint8_t char_classes[256] = {
+    _, _, _, _, _, _, _, _, _, S, S, S, S, S, _, _,
+    _, _, _, _, _, _, _, _, _, _, _, _, _, _, _, _,
+    S, O, Q, C, _, O, O, Q, P, P, O, O, P, O, P, O,
+    D, D, D, D, D, D, D, D, D, D, _, P, O, O, O, _,
+    _, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, P, _, P, _, I,
+    T, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, P, O, P, _, _,
+};
+
+#undef _
+#undef S
+#undef I
+#undef D
+#undef P
+#undef O
+#undef Q
+#undef T
+#undef C
+
+#define CHAR_CLASS(c) char_classes[(uint8_t)(c)]
 
 static bool is_identifier(char c)
 {
-    return isalpha(c) || c == '_';
+    return CHAR_CLASS(c) == CC_IDENT;
 }
 
 static bool is_digit(char c)
 {
-    return isdigit(c);
+    return CHAR_CLASS(c) == CC_DIGIT;
 }
 
 static bool is_punc(char c)
 {
-    return c == '(' || c == ')' || c == ',' || c == '.' || c == '{' || c == '}'
-        || c == ';' || c == '[' || c == ']';
+    return CHAR_CLASS(c) == CC_PUNC;
 }
 
 static bool is_comment(char c)
 {
-    return c == '#';
+    return CHAR_CLASS(c) == CC_COMMENT;
 }
 
 static bool is_op(char c)
 {
-    return c == '+' || c == '-' || c == '=' || c == '*' || c == '%' || c == '&' || 
-        c == '|' || c == '<' || c == '>' || c == '!' || c == '/'; 
+    return CHAR_CLASS(c) == CC_OP;
 }
 
 static bool is_string(char c)
 {
-    return c == '"' || c == '\'';
+    return CHAR_CLASS(c) == CC_QUOTE;
+}
+
+static bool is_template(char c)
+{
+    return CHAR_CLASS(c) == CC_TEMPLATE;
 }
 
 static bool is_space(char c)
 {
-    return isspace(c);
+    return CHAR_CLASS(c) == CC_SPACE;
 }
 
-static void scan_comment(charstream_t *source)
+static bool is_identifier_part(char c)
+{
+    return CHAR_CLASS(c) == CC_IDENT || CHAR_CLASS(c) == CC_DIGIT;
+}
+
+#ifdef LEXER_SSE2
+static __m128i in_range(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+static __m128i space_mask(__m128i v)
+{
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), in_range(v, '\t', '\r'));
+}
+
+static __m128i identifier_mask(__m128i v)
 {
-    while (charstream_next(source) != '\n')
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i mask = _mm_or_si128(in_range(lower, 'a', 'z'), in_range(v, '0', '9'));
+    return _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+}
+#endif
+
+// Length of the run of whitespace (or identifier characters) starting at the
+// current position. Whole 16 byte blocks are classified at once with SSE2 as
+// long as they lie inside the source.
+static unsigned int run_length(charstream_t *source, bool identifier)
+{
+    const char *p = source->pos;
+#ifdef LEXER_SSE2
+    while (source->end - p >= 16)
     {
-        if (charstream_eof(source)) break;
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        unsigned int mask = _mm_movemask_epi8(identifier ? identifier_mask(v) : space_mask(v));
+        if (mask != 0xffff) return (p - source->pos) + __builtin_ctz(~mask);
+        p += 16;
     }
+#endif
+    while (identifier ? is_identifier_part(*p) : is_space(*p)) p++;
+    return p - source->pos;
+}
+
+static void scan_comment(charstream_t *source)
+{
+    const char *newline = memchr(source->pos, '\n', source->end - source->pos);
+    charstream_advance(source, newline ? newline + 1 - source->pos : source->end - source->pos);
 }
 
 static token_t scan_string(charstream_t *source)
@@ -68,9 +154,43 @@ static token_t scan_string(charstream_t *source)
     return token_create(TOK_STR, start, bytes, source->line, source->col);
 }
 
+// Scans template text up to the closing backtick or the next ${, just after
+// the ` or } that opened this chunk. Each ${ pushes a brace counter so the
+// matching } can resume the template.
+static token_t scan_template(lexer_t *lexer)
+{
+    charstream_t *source = &lexer->source;
+    int start = source->offset;
+    int bytes = 0;
+
+    while (!charstream_eof(source))
+    {
+        char c = charstream_peek(source);
+        if (is_template(c))
+        {
+            charstream_next(source);
+            return token_create(TOK_TEMPLATE_END, start, bytes, source->line, source->col);
+        }
+        if (c == '$' && source->pos[1] == '{')
+        {
+            charstream_next(source);
+            charstream_next(source);
+            vector_push(int, lexer->templates, 0);
+            return token_create(TOK_TEMPLATE_STR, start, bytes, source->line, source->col);
+        }
+        charstream_next(source);
+        bytes++;
+    }
+
+    // read_next turns an error at eof into TOK_EOF, so count it here
+    charstream_error(source, "Unterminated template string");
+    lexer->nerrors++;
+    return token_error();
+}
+
 static bool is_number(char c)
 {
-    return isdigit(c) || c == '.'; 
+    return is_digit(c) || c == '.'; 
 }
 
 static token_t scan_number(charstream_t *source)
@@ -101,52 +221,41 @@ static token_t scan_number(charstream_t *source)
     return token_create(dot_found ? TOK_FLOAT : TOK_INT, start, bytes, source->line, source->col);
 }
 
-static bool strequals(const char *s1, int len, const char *s2)
+typedef struct
 {
-    int i = 0;
-    while (i < len)
-    {
-        if (s1[i] != s2[i]) return false;
-        i++;
-    }
-
-    return true;
-}
+    const char *name;
+    uint8_t length;
+    token_type type;
+} keyword_t;
+
+// Perfect hash over the keyword set: first and last character plus length.
+// Adding a keyword must keep every slot unique.
+#define KEYWORD_HASH(first, last, length) (((uint8_t)(first) + 2 * (uint8_t)(last) + 10 * (length)) & 31)
+#define KEYWORD(first, last, name, type) [KEYWORD_HASH(first, last, sizeof(name) - 1)] = { name, sizeof(name) - 1, type }
+
+static const keyword_t keywords[32] = {
+    KEYWORD('i', 'f', "if", TOK_IF),
+    KEYWORD('i', 'n', "in", TOK_IN),
+    KEYWORD('v', 'r', "var", TOK_VAR),
+    KEYWORD('f', 'r', "for", TOK_FOR),
+    KEYWORD('f', 'c', "func", TOK_FUNC),
+    KEYWORD('e', 'e', "else", TOK_ELSE),
+    KEYWORD('t', 'e', "true", TOK_TRUE),
+    KEYWORD('w', 'e', "while", TOK_WHILE),
+    KEYWORD('f', 'e', "false", TOK_FALSE),
+    KEYWORD('c', 's', "class", TOK_CLASS),
+    KEYWORD('r', 'n', "return", TOK_RETURN),
+    KEYWORD('s', 'c', "static", TOK_STATIC),
+    KEYWORD('o', 'r', "operator", TOK_OPERATOR),
+    KEYWORD('i', 't', "import", TOK_IMPORT),
+    KEYWORD('f', 'l', "final", TOK_FINAL),
+};
 
 static token_type get_keyword(charstream_t *source, int start, int bytes)
 {
-    char *iden = (char*)source->buffer + start;
-    if (bytes == 2)
-    {
-        if (strequals(iden, bytes, "if")) return TOK_IF;
-        if (strequals(iden, bytes, "in")) return TOK_IN;
-    }
-    if (bytes == 3)
-    {
-        if (strequals(iden, bytes, "var")) return TOK_VAR;
-        if (strequals(iden, bytes, "for")) return TOK_FOR;
-    }
-    if (bytes == 4)
-    {
-        if (strequals(iden, bytes, "func")) return TOK_FUNC;
-        if (strequals(iden, bytes, "else")) return TOK_ELSE;
-        if (strequals(iden, bytes, "true")) return TOK_TRUE;
-    }
-    if (bytes == 5)
-    {
-        if (strequals(iden, bytes, "while")) return TOK_WHILE;
-        if (strequals(iden, bytes, "false")) return TOK_FALSE;
-        if (strequals(iden, bytes, "class")) return TOK_CLASS;
-    }
-    if (bytes == 6)
-    {
-        if (strequals(iden, bytes, "return")) return TOK_RETURN;
-        if (strequals(iden, bytes, "static")) return TOK_STATIC;
-    }
-    if (bytes == 8)
-    {
-        if (strequals(iden, bytes, "operator")) return TOK_OPERATOR;
-    }
+    const char *iden = source->buffer + start;
+    const keyword_t *keyword = &keywords[KEYWORD_HASH(iden[0], iden[bytes - 1], bytes)];
+    if (keyword->length == bytes && memcmp(iden, keyword->name, bytes) == 0) return keyword->type;
     return TOK_IDENTIFIER;
 }
 
@@ -154,15 +263,8 @@ static token_t scan_identifier(charstream_t *source)
 {
     uint32_t start = source->offset;
     uint32_t col = source->col;
-    uint32_t bytes = 0;
-
-    while (is_identifier(charstream_peek(source)) || 
-        is_digit(charstream_peek(source)))
-    {
-        charstream_next(source);
-        bytes++;
-        if (charstream_eof(source)) break;
-    }
+    uint32_t bytes = run_length(source, true);
+    charstream_advance(source, bytes);
 
     return token_create(get_keyword(source, start, bytes), start, bytes, source->line, col);
 }
@@ -244,10 +346,28 @@ static token_t read_next(lexer_t *lexer)
     {
         char c = charstream_peek(&lexer->source);
 
-        if (is_space(c)) { charstream_next(&lexer->source); continue; }
+        if (is_space(c)) { charstream_advance(&lexer->source, run_length(&lexer->source, false)); continue; }
         if (is_comment(c)) { scan_comment(&lexer->source); continue; }
 
         if (is_string(c)) { token = scan_string(&lexer->source); break; }
+        if (is_template(c))
+        {
+            charstream_next(&lexer->source);
+            token = scan_template(lexer);
+            break;
+        }
+        if (vector_size(lexer->templates) > 0 && (c == '{' || c == '}'))
+        {
+            int *depth = &vector_peek(lexer->templates);
+            if (c == '}' && *depth == 0)
+            {
+                charstream_next(&lexer->source);
+                vector_pop(lexer->templates);
+                token = scan_template(lexer);
+                break;
+            }
+            *depth += c == '{' ? 1 : -1;
+        }
         if (is_digit(c)) { token = scan_number(&lexer->source); break; }
         if (is_identifier(c)) { token = scan_identifier(&lexer->source); break; }
         if (is_punc(c)) { token = scan_punc(&lexer->source); break; }
@@ -268,22 +388,9 @@ lexer_t lexer_create(const char *source)
     lexer_t lexer;
     lexer.source = charstream_create(source);
     lexer.nerrors = 0;
-
-    vector_t(token_t) tokens;
-    vector_init(tokens);
-    token_t current = read_next(&lexer);
-    while (current.type != TOK_EOF)
-    {
-        //printf("arg: %d %.*s\n", current.type, current.length, source + current.offset);
-        if (current.type != TOK_ERROR) vector_push(token_t, tokens, current);
-        else lexer.nerrors++;
-        current = read_next(&lexer);
-    }
-
-    lexer.ntokens = vector_size(tokens);
-    lexer.tokens = tokens.a;
     lexer.current = 0;
-
+    lexer.nscanned = 0;
+    vector_init(lexer.templates);
     return lexer;
 }
 
@@ -291,8 +398,23 @@ void lexer_destroy(lexer_t *lexer)
 {
     if (lexer)
     {
-        if (lexer->tokens) free(lexer->tokens);
+        vector_destroy(lexer->templates);
+    }
+}
+
+static token_t *lexer_token(lexer_t *lexer, uint32_t index)
+{
+    while (lexer->nscanned <= index)
+    {
+        token_t token = read_next(lexer);
+        if (token.type == TOK_ERROR)
+        {
+            lexer->nerrors++;
+            continue;
+        }
+        lexer->tokens[lexer->nscanned++ % LEXER_RING_SIZE] = token;
     }
+    return &lexer->tokens[index % LEXER_RING_SIZE];
 }
 
 token_t lexer_consume(lexer_t *lexer, token_type type)
@@ -304,17 +426,18 @@ token_t lexer_consume(lexer_t *lexer, token_type type)
 
 token_t lexer_advance(lexer_t *lexer)
 {
-    return lexer->tokens[lexer->current++];
+    return *lexer_token(lexer, lexer->current++);
 }
 
 token_t lexer_peek(lexer_t *lexer)
 {
-    return lexer->tokens[lexer->current];
+    return *lexer_token(lexer, lexer->current);
 }
 
 token_t lexer_previous(lexer_t * lexer)
 {
-    return lexer->tokens[lexer->current - 1];
+    if (lexer->current == 0) return token_error();
+    return *lexer_token(lexer, lexer->current - 1);
 }
 
 bool lexer_match(lexer_t *lexer, token_type type)
@@ -334,5 +457,5 @@ bool lexer_check(lexer_t *lexer, token_type type)
 
 bool lexer_end(lexer_t *lexer)
 {
-    return lexer->current >= lexer->ntokens;
+    return lexer_peek(lexer).type == TOK_EOF;
 }
\ No newline at end of file
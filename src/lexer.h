@@ -3,14 +3,23 @@
 
 #include "token.h"
 #include "charstream.h"
+#include "vector.h"
+
+// Tokens are produced on demand into a ring buffer; the parser only ever
+// looks one token ahead of or behind the current one.
+#define LEXER_RING_SIZE 4
 
 typedef struct
 {
     charstream_t source;
-    int current;
-    token_t *tokens;
-    int ntokens;
+    uint32_t current;
+    // number of tokens scanned so far, token i lives at tokens[i % LEXER_RING_SIZE]
+    uint32_t nscanned;
+    token_t tokens[LEXER_RING_SIZE];
     int nerrors;
+
+    // brace depth inside each template ${...} currently being scanned
+    vector_t(int) templates;
 } lexer_t;
 
 lexer_t lexer_create(const char *source);
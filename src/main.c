@@ -1,69 +1,85 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
-#include "ast.h"
+#include "bytecode.h"
+#include "cache.h"
 #include "clioptions.h"
-#include "codegen.h"
 #include "core.h"
 #include "debug.h"
+#include "module.h"
 #include "utils.h"
-#include "lexer.h"
-#include "semantic.h"
 #include "vector.h"
 #include "vm.h"
-#include "parser.h"
 
-int melon_compile(const char *file, function_t *func, cli_options_t *options)
+int melon_compile(const char *path, const char *file, function_t *func, cli_options_t *options, string_r *deps)
 {
     if (!file) return 1;
-    lexer_t lexer = lexer_create(file);
-    if (lexer.nerrors > 0) goto lexer_abort;
+    if (module_compile(path, file, func, options, deps)) return 0;
 
-    node_t *ast = parse(&lexer);
-    if (lexer.nerrors > 0) goto compile_abort;
-
-    if (options->c_print_ast) ast_print(ast);
-
-    if (!semantic_process(ast, &lexer)) goto compile_abort;
-
-    codegen_t gen = codegen_create(func);
-    if (!codegen_run(&gen, ast)) goto codegen_abort;
-
-    if (options->c_func_disasm) function_disassemble(func);
-    if (options->c_dump_cpool) function_cpool_dump(func);
-
-    codegen_destroy(&gen);
-    ast_free(ast);
-    lexer_destroy(&lexer);
-    return 0;
-
-codegen_abort:
-    codegen_destroy(&gen);
-compile_abort:
-    ast_free(ast);
-lexer_abort:
-    lexer_destroy(&lexer);
     printf("\nmelon fatal  : Errors in compilation\n");
     return 1;
 }
 
+// Writes the program next to its source, swapping .txt for the bytecode extension.
+static bool melon_emit_bytecode(function_t *func, const char *input)
+{
+    size_t stem = strlen(input) - strlen(".txt");
+    char *path = (char*)malloc(stem + strlen(BYTECODE_EXTENSION) + 1);
+    memcpy(path, input, stem);
+    strcpy(path + stem, BYTECODE_EXTENSION);
+
+    bool written = bytecode_write(func, path);
+    if (!written) printf("melon fatal  : Could not write bytecode to %s\n", path);
+    free(path);
+    return written;
+}
+
 int main(int argc, char **argv)
 {
     cli_options_t options = parse_cli_options(argc, argv);
     if (options.opt_exit) goto abort_file;
 
-    const char *file = file_read(options.c_input);
-    if (!file)
+    function_t *main_func = NULL;
+    core_init_classes();
+
+    if (options.c_bytecode)
     {
-        printf("melon fatal : Could not load file at %s\n", options.c_input);
-        goto abort_file;
+        main_func = bytecode_load(options.c_input);
+        if (!main_func) goto abort_compile;
     }
+    else
+    {
+        const char *file = file_read(options.c_input);
+        if (!file)
+        {
+            printf("melon fatal : Could not load file at %s\n", options.c_input);
+            goto abort_compile;
+        }
+
+        // the cache has no syntax tree to print
+        bool use_cache = options.c_use_cache && !options.c_print_ast;
+        if (use_cache) main_func = cache_load(options.c_input, file, options.c_inline_budget);
+        if (!main_func)
+        {
+            string_r deps;
+            vector_init(deps);
+            main_func = function_new(strdup("$main"));
+            bool compiled = melon_compile(options.c_input, file, main_func, &options, &deps) == 0;
+            if (compiled && use_cache) cache_store(options.c_input, file, options.c_inline_budget, main_func, &deps);
+
+            for (size_t i = 0; i < vector_size(deps); i++) free((void*)vector_get(deps, i));
+            vector_destroy(deps);
+            if (!compiled) goto abort_compile;
+        }
+
+        if (options.c_emit_bytecode && !melon_emit_bytecode(main_func, options.c_input)) goto abort_compile;
+    }
+
+    if (options.c_func_disasm) function_disassemble(main_func);
+    if (options.c_dump_cpool) function_cpool_dump(main_func);
 
-    function_t *main_func = function_new(strdup("$main"));
-    core_init_classes();
-    if (melon_compile(file, main_func, &options)) goto abort_compile;
-     
     if (options.r_run)
     {
         double start = milliseconds();
@@ -0,0 +1,534 @@
+#include "module.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "astwalker.h"
+#include "codegen.h"
+#include "core.h"
+#include "fold.h"
+#include "inliner.h"
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+#include "threads.h"
+#include "utils.h"
+
+// global slots are a single byte operand
+#define MAX_GLOBALS 256
+
+typedef enum
+{
+    LINK_UNVISITED, LINK_VISITING, LINK_DONE
+} link_state;
+
+typedef struct module_s
+{
+    char *path;
+    const char *source;
+    bool owns_source;
+
+    lexer_t lexer;
+    arena_t arena;
+    node_block_t *ast;
+    bool failed;
+
+    // module of each import statement of ast, in order
+    vector_t(struct module_s*) imports;
+
+    // where each slot of the module's own global scope lives in the program
+    uint8_t slots[MAX_GLOBALS];
+    link_state state;
+} module_t;
+
+typedef vector_t(module_t*) module_r;
+
+// A step run over a range of modules by every thread of a wave; each
+// thread claims the next module until there are none left.
+typedef struct
+{
+    module_r *modules;
+    size_t first;
+    uint32_t count;
+    volatile uint32_t next;
+    bool (*step)(module_t *module);
+} wave_t;
+
+static module_t *module_new(char *path, const char *source)
+{
+    module_t *module = (module_t*)calloc(1, sizeof(module_t));
+    module->path = path;
+    module->source = source;
+    module->arena = arena_create();
+    vector_init(module->imports);
+    module->state = LINK_UNVISITED;
+    return module;
+}
+
+static void module_free(module_t *module)
+{
+    arena_destroy(&module->arena);
+    lexer_destroy(&module->lexer);
+    vector_destroy(module->imports);
+    if (module->owns_source) free((void*)module->source);
+    free(module->path);
+    free(module);
+}
+
+static bool module_parse(module_t *module)
+{
+    if (!module->source)
+    {
+        module->source = file_read(module->path);
+        module->owns_source = true;
+        if (!module->source)
+        {
+            printf("melon fatal  : Could not load module at %s\n", module->path);
+            return false;
+        }
+    }
+
+    module->lexer = lexer_create(module->source);
+
+    ast_set_arena(&module->arena);
+    module->ast = (node_block_t*)parse(&module->lexer);
+    if (module->lexer.nerrors > 0) return false;
+
+    return semantic_declare((node_t*)module->ast, &module->lexer);
+}
+
+static bool module_resolve(module_t *module)
+{
+    ast_set_arena(&module->arena);
+    return semantic_resolve((node_t*)module->ast, &module->lexer);
+}
+
+static void wave_work(void *data)
+{
+    wave_t *wave = (wave_t*)data;
+    uint32_t i;
+    while ((i = threads_claim(&wave->next)) < wave->count)
+    {
+        module_t *module = vector_get(*wave->modules, wave->first + i);
+        if (!module->failed) module->failed = !wave->step(module);
+    }
+}
+
+static bool wave_run(module_r *modules, size_t first, bool (*step)(module_t*), uint32_t njobs)
+{
+    wave_t wave = {
+        .modules = modules,
+        .first = first,
+        .count = (uint32_t)(vector_size(*modules) - first),
+        .next = 0,
+        .step = step
+    };
+    threads_run(wave.count < njobs ? wave.count : njobs, wave_work, &wave);
+
+    bool failed = false;
+    for (size_t i = first; i < vector_size(*modules); i++)
+    {
+        module_t *module = vector_get(*modules, i);
+        if (module->failed && i > 0) printf("melon fatal  : Errors in module %s\n", module->path);
+        failed |= module->failed;
+    }
+    return !failed;
+}
+
+// Paths are relative to the directory of the importing module.
+static char *import_path(module_t *module, const char *path)
+{
+    if (path[0] == '/') return path_resolve(path);
+
+    const char *sep = strrchr(module->path, '/');
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    const char *backslash = strrchr(module->path, '\\');
+    if (backslash > sep) sep = backslash;
+#endif
+    size_t dirlen = sep ? sep - module->path + 1 : 0;
+    char *joined = (char*)malloc(dirlen + strlen(path) + 1);
+    memcpy(joined, module->path, dirlen);
+    strcpy(joined + dirlen, path);
+
+    char *resolved = path_resolve(joined);
+    free(joined);
+    return resolved;
+}
+
+static module_t *find_module(module_r *modules, const char *path)
+{
+    for (size_t i = 0; i < vector_size(*modules); i++)
+    {
+        module_t *module = vector_get(*modules, i);
+        if (strcmp(module->path, path) == 0) return module;
+    }
+    return NULL;
+}
+
+static bool collect_imports(module_r *modules, module_t *module)
+{
+    bool found = true;
+    node_r *stmts = module->ast->stmts;
+    for (size_t i = 0; i < vector_size(*stmts); i++)
+    {
+        node_import_t *import = (node_import_t*)vector_get(*stmts, i);
+        if (import->base.type != NODE_IMPORT) continue;
+
+        char *path = import_path(module, import->path);
+        if (!path)
+        {
+            printf("line %d: error: Could not find module %s imported by %s\n",
+                import->base.token.line, import->path, module->path);
+            found = false;
+            continue;
+        }
+
+        module_t *imported = find_module(modules, path);
+        if (imported) free(path);
+        else
+        {
+            imported = module_new(path, NULL);
+            vector_push(module_t*, *modules, imported);
+        }
+        vector_push(module_t*, module->imports, imported);
+    }
+    return found;
+}
+
+// Orders modules so that each one comes after everything it imports.
+static bool link_order(module_t *module, module_r *order)
+{
+    if (module->state == LINK_DONE) return true;
+    if (module->state == LINK_VISITING)
+    {
+        printf("melon fatal  : Circular import of module %s\n", module->path);
+        return false;
+    }
+
+    module->state = LINK_VISITING;
+    for (size_t i = 0; i < vector_size(module->imports); i++)
+    {
+        if (!link_order(vector_get(module->imports, i), order)) return false;
+    }
+    module->state = LINK_DONE;
+    vector_push(module_t*, *order, module);
+    return true;
+}
+
+static bool import_names(module_t *module)
+{
+    ast_set_arena(&module->arena);
+
+    bool imported = true;
+    size_t n = 0;
+    node_r *stmts = module->ast->stmts;
+    for (size_t i = 0; i < vector_size(*stmts); i++)
+    {
+        node_import_t *import = (node_import_t*)vector_get(*stmts, i);
+        if (import->base.type != NODE_IMPORT) continue;
+
+        module_t *imported_module = vector_get(module->imports, n++);
+        import->module = imported_module->ast;
+
+        // a second import of the same module brings in nothing new
+        bool repeated = false;
+        for (size_t j = 0; j < n - 1; j++)
+        {
+            repeated |= vector_get(module->imports, j) == imported_module;
+        }
+        if (!repeated) imported &= semantic_import((node_t*)module->ast, &module->lexer, import);
+    }
+    return imported;
+}
+
+// Relocation: every global slot a module refers to is collected first, then
+// rewritten once the slots of the whole program are known.
+
+typedef struct
+{
+    vector_t(uint8_t*) refs;
+    bool used[MAX_GLOBALS];
+} relocs_t;
+
+#define RELOCS ((relocs_t*)self->data)
+
+static void reloc_add(astwalker_t *self, location_e loc, uint8_t *idx)
+{
+    if (loc != LOC_GLOBAL) return;
+    vector_push(uint8_t*, RELOCS->refs, idx);
+    RELOCS->used[*idx] = true;
+}
+
+static void reloc_nodes(astwalker_t *self, node_r *nodes)
+{
+    if (!nodes) return;
+    for (size_t i = 0; i < vector_size(*nodes); i++)
+    {
+        node_t *node = vector_get(*nodes, i);
+        if (node) walk_ast(self, node);
+    }
+}
+
+static void reloc_block(astwalker_t *self, node_block_t *node)
+{
+    reloc_nodes(self, node->stmts);
+}
+
+static void reloc_if(astwalker_t *self, node_if_t *node)
+{
+    walk_ast(self, node->cond);
+    walk_ast(self, node->then);
+    if (node->els) walk_ast(self, node->els);
+}
+
+static void reloc_loop(astwalker_t *self, node_loop_t *node)
+{
+    if (node->init) walk_ast(self, node->init);
+    if (node->cond) walk_ast(self, node->cond);
+    if (node->inc) walk_ast(self, node->inc);
+    walk_ast(self, node->body);
+
+    if (node->type == LOOP_FORIN)
+    {
+        reloc_add(self, node->loc, &node->target_idx);
+        reloc_add(self, node->loc, &node->it_idx);
+    }
+}
+
+static void reloc_return(astwalker_t *self, node_return_t *node)
+{
+    if (node->expr) walk_ast(self, node->expr);
+}
+
+static void reloc_var_decl(astwalker_t *self, node_var_decl_t *node)
+{
+    if (node->init) walk_ast(self, node->init);
+    reloc_add(self, node->loc, &node->idx);
+}
+
+static void reloc_func_decl(astwalker_t *self, node_func_decl_t *node)
+{
+    walk_ast(self, (node_t*)node->body);
+}
+
+static void reloc_class_decl(astwalker_t *self, node_class_decl_t *node)
+{
+    reloc_add(self, node->loc, &node->idx);
+    reloc_nodes(self, node->decls);
+}
+
+static void reloc_binary(astwalker_t *self, node_binary_t *node)
+{
+    walk_ast(self, node->left);
+    walk_ast(self, node->right);
+}
+
+static void reloc_unary(astwalker_t *self, node_unary_t *node)
+{
+    walk_ast(self, node->right);
+}
+
+static void reloc_postfix(astwalker_t *self, node_postfix_t *node)
+{
+    walk_ast(self, node->target);
+    for (size_t i = 0; node->exprs && i < vector_size(*node->exprs); i++)
+    {
+        postfix_expr_t *expr = vector_get(*node->exprs, i);
+        if (expr->type == POST_CALL) reloc_nodes(self, expr->args);
+        else if (expr->type == POST_SUBSCRIPT) walk_ast(self, expr->accessor);
+    }
+}
+
+static void reloc_var(astwalker_t *self, node_var_t *node)
+{
+    reloc_add(self, node->location, &node->idx);
+}
+
+static void reloc_list(astwalker_t *self, node_list_t *node)
+{
+    reloc_nodes(self, node->items);
+}
+
+static void reloc_range(astwalker_t *self, node_range_t *node)
+{
+    walk_ast(self, node->start);
+    walk_ast(self, node->end);
+}
+
+static void reloc_concat(astwalker_t *self, node_concat_t *node)
+{
+    reloc_nodes(self, node->parts);
+}
+
+// Gives the module's own globals the next free slots of the program and
+// points its imported names at the slots of the modules declaring them.
+static bool link_module(module_t *module, uint32_t *nglobals)
+{
+    relocs_t relocs = { .used = { false } };
+    vector_init(relocs.refs);
+
+    astwalker_t walker = {
+        .data = (void*)&relocs,
+
+        .visit_block = reloc_block,
+        .visit_if = reloc_if,
+        .visit_loop = reloc_loop,
+        .visit_return = reloc_return,
+
+        .visit_var_decl = reloc_var_decl,
+        .visit_func_decl = reloc_func_decl,
+        .visit_class_decl = reloc_class_decl,
+
+        .visit_binary = reloc_binary,
+        .visit_unary = reloc_unary,
+        .visit_postfix = reloc_postfix,
+        .visit_var = reloc_var,
+        .visit_list = reloc_list,
+        .visit_range = reloc_range,
+        .visit_literal = NULL,
+        .visit_concat = reloc_concat
+    };
+    walk_ast(&walker, (node_t*)module->ast);
+
+    for (uint32_t i = 0; i < CORE_NGLOBALS; i++)
+    {
+        module->slots[i] = i;
+        relocs.used[i] = false;
+    }
+
+    size_t n = 0;
+    node_r *stmts = module->ast->stmts;
+    for (size_t i = 0; i < vector_size(*stmts); i++)
+    {
+        node_import_t *import = (node_import_t*)vector_get(*stmts, i);
+        if (import->base.type != NODE_IMPORT) continue;
+
+        module_t *imported = vector_get(module->imports, n++);
+        for (size_t j = 0; j < vector_size(*import->names); j++)
+        {
+            ast_import_t name = vector_get(*import->names, j);
+            module->slots[name.idx] = imported->slots[name.module_idx];
+            relocs.used[name.idx] = false;
+        }
+    }
+
+    bool linked = true;
+    for (uint32_t i = CORE_NGLOBALS; i < MAX_GLOBALS; i++)
+    {
+        if (!relocs.used[i]) continue;
+        if (*nglobals >= MAX_GLOBALS)
+        {
+            printf("melon fatal  : Too many globals in program, the limit is %d\n", MAX_GLOBALS);
+            linked = false;
+            break;
+        }
+        module->slots[i] = (uint8_t)(*nglobals)++;
+    }
+
+    for (size_t i = 0; linked && i < vector_size(relocs.refs); i++)
+    {
+        uint8_t *idx = vector_get(relocs.refs, i);
+        *idx = module->slots[*idx];
+    }
+
+    vector_destroy(relocs.refs);
+    return linked;
+}
+
+// One tree running every module in link order, without the import statements.
+static node_t *link_program(module_r *order)
+{
+    node_r *stmts = (node_r*)arena_alloc(ast_arena(), sizeof(node_r));
+    for (size_t i = 0; i < vector_size(*order); i++)
+    {
+        node_r *module_stmts = vector_get(*order, i)->ast->stmts;
+        for (size_t j = 0; j < vector_size(*module_stmts); j++)
+        {
+            node_t *stmt = vector_get(*module_stmts, j);
+            if (stmt->type != NODE_IMPORT) vector_push_arena(node_t*, *stmts, stmt, ast_arena());
+        }
+    }
+
+    node_block_t *program = (node_block_t*)node_block_new(stmts);
+    program->is_root = true;
+    return (node_t*)program;
+}
+
+bool module_compile(const char *path, const char *source, function_t *func, cli_options_t *options, string_r *deps)
+{
+    uint32_t njobs = options->c_jobs ? options->c_jobs : threads_available();
+    bool compiled = false;
+
+    module_r modules;
+    module_r order;
+    vector_init(modules);
+    vector_init(order);
+
+    char *resolved = path_resolve(path);
+    vector_push(module_t*, modules, module_new(resolved ? resolved : strdup(path), source));
+
+    // modules are discovered a wave at a time: the ones found by parsing the
+    // previous wave. The input file makes up the first wave on its own, which
+    // also sets up the parser before any other thread uses it.
+    size_t first = 0;
+    bool parsed = true;
+    while (first < vector_size(modules))
+    {
+        size_t end = vector_size(modules);
+        parsed &= wave_run(&modules, first, module_parse, njobs);
+
+        for (size_t i = first; i < end; i++)
+        {
+            module_t *module = vector_get(modules, i);
+            if (!module->failed) parsed &= collect_imports(&modules, module);
+        }
+        first = end;
+    }
+    if (!parsed) goto cleanup;
+
+    if (!link_order(vector_get(modules, 0), &order)) goto cleanup;
+
+    if (options->c_print_ast)
+    {
+        for (size_t i = 0; i < vector_size(order); i++) ast_print((node_t*)vector_get(order, i)->ast);
+    }
+
+    bool imported = true;
+    for (size_t i = 0; i < vector_size(order); i++)
+    {
+        imported &= import_names(vector_get(order, i));
+    }
+    if (!imported || !wave_run(&modules, 0, module_resolve, njobs)) goto cleanup;
+
+    uint32_t nglobals = CORE_NGLOBALS;
+    for (size_t i = 0; i < vector_size(order); i++)
+    {
+        if (!link_module(vector_get(order, i), &nglobals)) goto cleanup;
+    }
+
+    // the linked tree and whatever the optimizers add to it belong to the input file
+    ast_set_arena(&vector_get(modules, 0)->arena);
+    node_t *program = link_program(&order);
+    inline_process(program, options->c_inline_budget);
+    fold_process(program);
+
+    codegen_t gen = codegen_create(func);
+    compiled = codegen_run(&gen, program);
+    codegen_destroy(&gen);
+
+    for (size_t i = 1; compiled && i < vector_size(modules); i++)
+    {
+        vector_push(const char*, *deps, strdup(vector_get(modules, i)->path));
+    }
+
+cleanup:
+    ast_set_arena(NULL);
+    for (size_t i = 0; i < vector_size(modules); i++)
+    {
+        module_free(vector_get(modules, i));
+    }
+    vector_destroy(modules);
+    vector_destroy(order);
+    return compiled;
+}
\ No newline at end of file
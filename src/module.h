@@ -0,0 +1,29 @@
+#ifndef __MODULE__
+#define __MODULE__
+
+#include <stdbool.h>
+
+#include "clioptions.h"
+#include "value.h"
+#include "vector.h"
+
+// Identifies the code this compiler generates, so that programs compiled by
+// an earlier one are never reused from the cache. Bump it with every change
+// that can alter the bytecode generated for some program: parsing, semantic
+// analysis, inference, inlining, folding, codegen or the optimizer.
+#define COMPILER_VERSION 2
+
+// A program is its input file plus every module reached through statements
+// like `import "shapes.txt";`, whose path is relative to the importing file.
+// Each module has its own global scope; an import makes the top level
+// declarations of the imported module visible, but not assignable, in the
+// importing one unless it declares the same name itself. Modules are lexed, parsed and analyzed independently on up
+// to options->c_jobs threads and then linked into a single tree, in which each
+// module runs once, after the modules it imports.
+
+// Compiles the program whose input file at path holds source into func, and
+// adds the resolved path of every imported module to deps. Errors are
+// reported as they are found.
+bool module_compile(const char *path, const char *source, function_t *func, cli_options_t *options, string_r *deps);
+
+#endif
\ No newline at end of file
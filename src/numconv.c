@@ -0,0 +1,446 @@
+#include "numconv.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Digits are produced two at a time from the end of a scratch buffer.
+int num_format_int(char *buffer, int value)
+{
+    char tmp[16];
+    char *p = tmp + sizeof(tmp);
+    uint32_t u = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    while (u >= 100)
+    {
+        const char *pair = digit_pairs + (u % 100) * 2;
+        u /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (u >= 10)
+    {
+        *--p = digit_pairs[u * 2 + 1];
+        *--p = digit_pairs[u * 2];
+    }
+    else
+    {
+        *--p = (char)('0' + u);
+    }
+    if (value < 0) *--p = '-';
+
+    int len = (int)(tmp + sizeof(tmp) - p);
+    memcpy(buffer, p, len);
+    buffer[len] = '\0';
+    return len;
+}
+
+// Shortest round-trip formatting of doubles, after Florian Loitsch's Grisu2
+// ("Printing Floating-Point Numbers Quickly and Accurately with Integers").
+// The digits always parse back to the same double and are the shortest such
+// digits for all but a tiny fraction of inputs.
+
+typedef struct
+{
+    uint64_t f;
+    int e;
+} diyfp_t;
+
+#define DP_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define DP_EXPONENT_MASK    0x7FF0000000000000ULL
+#define DP_HIDDEN_BIT       0x0010000000000000ULL
+#define DP_EXPONENT_BIAS    (0x3FF + 52)
+
+// Normalized 10^k for k = -348, -340, ..., 340.
+static const diyfp_t cached_powers[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220 }, { 0xbaaee17fa23ebf76ULL, -1193 },
+    { 0x8b16fb203055ac76ULL, -1166 }, { 0xcf42894a5dce35eaULL, -1140 },
+    { 0x9a6bb0aa55653b2dULL, -1113 }, { 0xe61acf033d1a45dfULL, -1087 },
+    { 0xab70fe17c79ac6caULL, -1060 }, { 0xff77b1fcbebcdc4fULL, -1034 },
+    { 0xbe5691ef416bd60cULL, -1007 }, { 0x8dd01fad907ffc3cULL, -980 },
+    { 0xd3515c2831559a83ULL, -954 }, { 0x9d71ac8fada6c9b5ULL, -927 },
+    { 0xea9c227723ee8bcbULL, -901 }, { 0xaecc49914078536dULL, -874 },
+    { 0x823c12795db6ce57ULL, -847 }, { 0xc21094364dfb5637ULL, -821 },
+    { 0x9096ea6f3848984fULL, -794 }, { 0xd77485cb25823ac7ULL, -768 },
+    { 0xa086cfcd97bf97f4ULL, -741 }, { 0xef340a98172aace5ULL, -715 },
+    { 0xb23867fb2a35b28eULL, -688 }, { 0x84c8d4dfd2c63f3bULL, -661 },
+    { 0xc5dd44271ad3cdbaULL, -635 }, { 0x936b9fcebb25c996ULL, -608 },
+    { 0xdbac6c247d62a584ULL, -582 }, { 0xa3ab66580d5fdaf6ULL, -555 },
+    { 0xf3e2f893dec3f126ULL, -529 }, { 0xb5b5ada8aaff80b8ULL, -502 },
+    { 0x87625f056c7c4a8bULL, -475 }, { 0xc9bcff6034c13053ULL, -449 },
+    { 0x964e858c91ba2655ULL, -422 }, { 0xdff9772470297ebdULL, -396 },
+    { 0xa6dfbd9fb8e5b88fULL, -369 }, { 0xf8a95fcf88747d94ULL, -343 },
+    { 0xb94470938fa89bcfULL, -316 }, { 0x8a08f0f8bf0f156bULL, -289 },
+    { 0xcdb02555653131b6ULL, -263 }, { 0x993fe2c6d07b7facULL, -236 },
+    { 0xe45c10c42a2b3b06ULL, -210 }, { 0xaa242499697392d3ULL, -183 },
+    { 0xfd87b5f28300ca0eULL, -157 }, { 0xbce5086492111aebULL, -130 },
+    { 0x8cbccc096f5088ccULL, -103 }, { 0xd1b71758e219652cULL, -77 },
+    { 0x9c40000000000000ULL, -50 }, { 0xe8d4a51000000000ULL, -24 },
+    { 0xad78ebc5ac620000ULL, 3 }, { 0x813f3978f8940984ULL, 30 },
+    { 0xc097ce7bc90715b3ULL, 56 }, { 0x8f7e32ce7bea5c70ULL, 83 },
+    { 0xd5d238a4abe98068ULL, 109 }, { 0x9f4f2726179a2245ULL, 136 },
+    { 0xed63a231d4c4fb27ULL, 162 }, { 0xb0de65388cc8ada8ULL, 189 },
+    { 0x83c7088e1aab65dbULL, 216 }, { 0xc45d1df942711d9aULL, 242 },
+    { 0x924d692ca61be758ULL, 269 }, { 0xda01ee641a708deaULL, 295 },
+    { 0xa26da3999aef774aULL, 322 }, { 0xf209787bb47d6b85ULL, 348 },
+    { 0xb454e4a179dd1877ULL, 375 }, { 0x865b86925b9bc5c2ULL, 402 },
+    { 0xc83553c5c8965d3dULL, 428 }, { 0x952ab45cfa97a0b3ULL, 455 },
+    { 0xde469fbd99a05fe3ULL, 481 }, { 0xa59bc234db398c25ULL, 508 },
+    { 0xf6c69a72a3989f5cULL, 534 }, { 0xb7dcbf5354e9beceULL, 561 },
+    { 0x88fcf317f22241e2ULL, 588 }, { 0xcc20ce9bd35c78a5ULL, 614 },
+    { 0x98165af37b2153dfULL, 641 }, { 0xe2a0b5dc971f303aULL, 667 },
+    { 0xa8d9d1535ce3b396ULL, 694 }, { 0xfb9b7cd9a4a7443cULL, 720 },
+    { 0xbb764c4ca7a44410ULL, 747 }, { 0x8bab8eefb6409c1aULL, 774 },
+    { 0xd01fef10a657842cULL, 800 }, { 0x9b10a4e5e9913129ULL, 827 },
+    { 0xe7109bfba19c0c9dULL, 853 }, { 0xac2820d9623bf429ULL, 880 },
+    { 0x80444b5e7aa7cf85ULL, 907 }, { 0xbf21e44003acdd2dULL, 933 },
+    { 0x8e679c2f5e44ff8fULL, 960 }, { 0xd433179d9c8cb841ULL, 986 },
+    { 0x9e19db92b4e31ba9ULL, 1013 }, { 0xeb96bf6ebadf77d9ULL, 1039 },
+    { 0xaf87023b9bf0ee6bULL, 1066 },
+};
+
+static const uint64_t pow10_u64[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static diyfp_t diyfp_from_double(double d)
+{
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    int biased_e = (int)((u & DP_EXPONENT_MASK) >> 52);
+    uint64_t significand = u & DP_SIGNIFICAND_MASK;
+
+    diyfp_t r;
+    if (biased_e != 0)
+    {
+        r.f = significand + DP_HIDDEN_BIT;
+        r.e = biased_e - DP_EXPONENT_BIAS;
+    }
+    else
+    {
+        r.f = significand;
+        r.e = 1 - DP_EXPONENT_BIAS;
+    }
+    return r;
+}
+
+// Upper 64 bits of the 128-bit product, rounded.
+static diyfp_t diyfp_mul(diyfp_t x, diyfp_t y)
+{
+    const uint64_t m32 = 0xFFFFFFFFULL;
+    uint64_t a = x.f >> 32, b = x.f & m32;
+    uint64_t c = y.f >> 32, d = y.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32);
+    tmp += 1ULL << 31;
+
+    diyfp_t r = { ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64 };
+    return r;
+}
+
+static diyfp_t diyfp_normalize(diyfp_t x)
+{
+    while (!(x.f & (1ULL << 63)))
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+// The neighbours halfway to the previous and next doubles, sharing plus's exponent.
+static void diyfp_boundaries(diyfp_t v, diyfp_t *minus, diyfp_t *plus)
+{
+    diyfp_t pl = { (v.f << 1) + 1, v.e - 1 };
+    pl = diyfp_normalize(pl);
+
+    diyfp_t mi;
+    if (v.f == DP_HIDDEN_BIT)
+    {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    }
+    else
+    {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    *minus = mi;
+    *plus = pl;
+}
+
+static diyfp_t cached_power(int e, int *k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if (dk - ik > 0.0) ik++;
+
+    unsigned index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    return cached_powers[index];
+}
+
+static int count_digits(uint32_t n)
+{
+    int digits = 1;
+    while (n >= 10)
+    {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+static void grisu_round(char *digits, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+    {
+        digits[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static void digit_gen(diyfp_t w, diyfp_t mp, uint64_t delta, char *digits, int *len, int *k)
+{
+    diyfp_t one = { 1ULL << -mp.e, mp.e };
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = count_digits(p1);
+    *len = 0;
+
+    while (kappa > 0)
+    {
+        uint32_t div = (uint32_t)pow10_u64[kappa - 1];
+        uint32_t d = p1 / div;
+        p1 %= div;
+        if (d || *len) digits[(*len)++] = (char)('0' + d);
+        kappa--;
+
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta)
+        {
+            *k += kappa;
+            grisu_round(digits, *len, delta, rest, pow10_u64[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    for (;;)
+    {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || *len) digits[(*len)++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+            *k += kappa;
+            grisu_round(digits, *len, delta, p2, one.f, wp_w * pow10_u64[-kappa]);
+            return;
+        }
+    }
+}
+
+// value must be finite and positive. The result is digits * 10^k.
+static void grisu2(double value, char *digits, int *len, int *k)
+{
+    diyfp_t v = diyfp_from_double(value);
+    diyfp_t w_m, w_p;
+    diyfp_boundaries(v, &w_m, &w_p);
+
+    diyfp_t c_mk = cached_power(w_p.e, k);
+    diyfp_t w = diyfp_mul(diyfp_normalize(v), c_mk);
+    diyfp_t wp = diyfp_mul(w_p, c_mk);
+    diyfp_t wm = diyfp_mul(w_m, c_mk);
+    wm.f++;
+    wp.f--;
+    digit_gen(w, wp, wp.f - wm.f, digits, len, k);
+}
+
+// Plain notation while the decimal point stays within 21 digits (with ".0"
+// kept on integral values so they still read as floats), exponent otherwise.
+static int format_digits(char *buffer, const char *digits, int len, int k)
+{
+    int point = len + k;
+    char *p = buffer;
+    if (k >= 0 && point <= 21)
+    {
+        memcpy(p, digits, len);
+        p += len;
+        memset(p, '0', k);
+        p += k;
+        *p++ = '.';
+        *p++ = '0';
+    }
+    else if (point > 0 && point <= 21)
+    {
+        memcpy(p, digits, point);
+        p += point;
+        *p++ = '.';
+        memcpy(p, digits + point, len - point);
+        p += len - point;
+    }
+    else if (point > -6 && point <= 0)
+    {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -point);
+        p += -point;
+        memcpy(p, digits, len);
+        p += len;
+    }
+    else
+    {
+        *p++ = digits[0];
+        if (len > 1)
+        {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        *p++ = 'e';
+        return (int)(p - buffer) + num_format_int(p, point - 1);
+    }
+    *p = '\0';
+    return (int)(p - buffer);
+}
+
+int num_format_double(char *buffer, double value)
+{
+    if (isnan(value))
+    {
+        strcpy(buffer, "nan");
+        return 3;
+    }
+
+    char *p = buffer;
+    if (signbit(value))
+    {
+        *p++ = '-';
+        value = -value;
+    }
+    if (isinf(value))
+    {
+        strcpy(p, "inf");
+        return (int)(p - buffer) + 3;
+    }
+    if (value == 0.0)
+    {
+        strcpy(p, "0.0");
+        return (int)(p - buffer) + 3;
+    }
+
+    char digits[20];
+    int len, k;
+    grisu2(value, digits, &len, &k);
+    return (int)(p - buffer) + format_digits(p, digits, len, k);
+}
+
+bool num_parse_int(const char *s, uint32_t len, int *out)
+{
+    uint32_t i = 0;
+    bool negative = false;
+    if (i < len && (s[i] == '-' || s[i] == '+')) negative = s[i++] == '-';
+    if (i == len) return false;
+
+    uint64_t limit = negative ? 2147483648ULL : 2147483647ULL;
+    uint64_t v = 0;
+    for (; i < len; i++)
+    {
+        unsigned d = (unsigned)(s[i] - '0');
+        if (d > 9) return false;
+        v = v * 10 + d;
+        if (v > limit) return false;
+    }
+
+    *out = (int)(negative ? -(int64_t)v : (int64_t)v);
+    return true;
+}
+
+static const double exact_pow10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define MAX_EXACT_MANTISSA (1ULL << 53)
+
+// Accepts [+-]digits[.digits][(e|E)[+-]digits] with at least one mantissa digit.
+// When the mantissa and the power of ten are both exactly representable a
+// single multiply or divide gives the correctly rounded result (Clinger's fast
+// path), anything else is handed to strtod.
+bool num_parse_double(const char *s, uint32_t len, double *out)
+{
+    uint32_t i = 0;
+    bool negative = false;
+    if (i < len && (s[i] == '-' || s[i] == '+')) negative = s[i++] == '-';
+
+    uint64_t mantissa = 0;
+    int exp10 = 0;
+    int ndigits = 0;
+    bool exact = true;
+    for (; i < len && s[i] >= '0' && s[i] <= '9'; i++, ndigits++)
+    {
+        if (mantissa < MAX_EXACT_MANTISSA) mantissa = mantissa * 10 + (s[i] - '0');
+        else exact = false;
+    }
+    if (i < len && s[i] == '.')
+    {
+        for (i++; i < len && s[i] >= '0' && s[i] <= '9'; i++, ndigits++)
+        {
+            if (mantissa < MAX_EXACT_MANTISSA)
+            {
+                mantissa = mantissa * 10 + (s[i] - '0');
+                exp10--;
+            }
+            else exact = false;
+        }
+    }
+    if (ndigits == 0) return false;
+
+    if (i < len && (s[i] == 'e' || s[i] == 'E'))
+    {
+        i++;
+        bool exp_negative = false;
+        if (i < len && (s[i] == '-' || s[i] == '+')) exp_negative = s[i++] == '-';
+        if (i == len) return false;
+
+        int e = 0;
+        for (; i < len && s[i] >= '0' && s[i] <= '9'; i++)
+        {
+            if (e < 100000) e = e * 10 + (s[i] - '0');
+        }
+        exp10 += exp_negative ? -e : e;
+    }
+    if (i != len) return false;
+
+    if (exact && mantissa <= MAX_EXACT_MANTISSA && exp10 >= -22 && exp10 <= 22)
+    {
+        double d = (double)mantissa;
+        d = exp10 < 0 ? d / exact_pow10[-exp10] : d * exact_pow10[exp10];
+        *out = negative ? -d : d;
+        return true;
+    }
+
+    *out = strtod(s, NULL);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef __NUMCONV__
+#define __NUMCONV__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Large enough for any int or double formatted by num_format_*, including the terminator.
+#define NUMCONV_BUFFER_SIZE 32
+
+// Both formatters write a NUL terminated string into buffer and return its length.
+// Doubles use the shortest digit string that parses back to the same value.
+int num_format_int(char *buffer, int value);
+int num_format_double(char *buffer, double value);
+
+// Parse the whole of s[0..len), s must be NUL terminated at len.
+// Return false if s is not a number or does not fit the type.
+bool num_parse_int(const char *s, uint32_t len, int *out);
+bool num_parse_double(const char *s, uint32_t len, double *out);
+
+#endif
\ No newline at end of file
@@ -26,6 +26,7 @@ typedef enum
     OP_CLOSURE,
     OP_CLOSE,
     OP_CALL,
+    OP_INVOKE,       // INVOKE_METHOD        idx, nargs            [nargs: object, args]
     OP_JMP,
     OP_LOOP,
     OP_JIF,
@@ -49,8 +50,15 @@ typedef enum
     OP_EQ,
     OP_NEQ,
 
+    // unchecked variants for operands proven int (II) or float (FF)
+    OP_ADD_II, OP_SUB_II, OP_MUL_II, OP_DIV_II, OP_MOD_II,
+    OP_LT_II, OP_GT_II, OP_LTE_II, OP_GTE_II, OP_EQ_II, OP_NEQ_II,
+    OP_ADD_FF, OP_SUB_FF, OP_MUL_FF, OP_DIV_FF,
+    OP_LT_FF, OP_GT_FF, OP_LTE_FF, OP_GTE_FF, OP_EQ_FF, OP_NEQ_FF,
+
     OP_NEWARR,
     OP_NEWRNG,
+    OP_CONCAT,
 
     OP_HALT
 } opcode;
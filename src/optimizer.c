@@ -0,0 +1,256 @@
+#include "optimizer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "opcodes.h"
+
+#define OPT_START   0x01    // an instruction starts at this offset
+#define OPT_TARGET  0x02    // a jump lands on this instruction
+#define OPT_LIVE    0x04    // reachable from the entry point
+#define OPT_REMOVED 0x08    // dropped, control falls through to the next instruction
+
+#define MAX_THREAD_HOPS 16
+
+typedef struct
+{
+    uint8_t *code;
+    uint32_t len;
+    uint8_t *flags;
+    uint8_t *length;        // decoded size, kept when a jump is rewritten into a return
+    uint32_t *target;       // jump destination, indexed by instruction offset
+    uint32_t *newpos;
+} optimizer_t;
+
+static bool is_jump(uint8_t op)
+{
+    return op == OP_JMP || op == OP_LOOP || op == OP_JIF;
+}
+
+static bool is_terminator(uint8_t op)
+{
+    return op == OP_RETURN || op == OP_RET0 || op == OP_HALT;
+}
+
+static uint32_t next_inst(optimizer_t *opt, uint32_t pos)
+{
+    return pos + opt->length[pos];
+}
+
+// Removed instructions have no effect, so landing on one is the same as
+// landing on the first instruction kept after it.
+static uint32_t skip_removed(optimizer_t *opt, uint32_t pos)
+{
+    while (pos < opt->len && (opt->flags[pos] & OPT_REMOVED)) pos = next_inst(opt, pos);
+    return pos;
+}
+
+static bool decode(optimizer_t *opt)
+{
+    for (uint32_t pos = 0; pos < opt->len; pos = next_inst(opt, pos))
+    {
+        uint8_t op = opt->code[pos];
+        opt->flags[pos] |= OPT_START;
+        opt->length[pos] = op_length((opcode)op);
+        if (next_inst(opt, pos) > opt->len) return false;
+        if (!is_jump(op)) continue;
+
+        uint8_t offset = opt->code[pos + 1];
+        if (op == OP_LOOP && offset > pos + 1) return false;
+        uint32_t target = op == OP_LOOP ? pos + 1 - offset : pos + 1 + offset;
+        if (target > opt->len) return false;
+        opt->target[pos] = target;
+    }
+
+    for (uint32_t pos = 0; pos < opt->len; pos = next_inst(opt, pos))
+    {
+        if (!is_jump(opt->code[pos])) continue;
+        uint32_t target = opt->target[pos];
+        if (target < opt->len && !(opt->flags[target] & OPT_START)) return false;
+        opt->flags[target] |= OPT_TARGET;
+    }
+    return true;
+}
+
+// `loadk <bool>; jif` and `loadi; jif` always go the same way: a true or int
+// condition never jumps, a false one always does.
+static void fold_constant_branches(optimizer_t *opt, function_t *f)
+{
+    for (uint32_t pos = 0; pos < opt->len; pos = next_inst(opt, pos))
+    {
+        uint8_t op = opt->code[pos];
+        if (op != OP_LOADK && op != OP_LOADI) continue;
+
+        uint32_t jif = next_inst(opt, pos);
+        if (jif >= opt->len || opt->code[jif] != OP_JIF || (opt->flags[jif] & OPT_TARGET)) continue;
+
+        bool jumps = false;
+        if (op == OP_LOADK)
+        {
+            value_t v = function_cpool_get(f, opt->code[pos + 1]);
+            if (!IS_BOOL(v)) continue;
+            jumps = !AS_BOOL(v);
+        }
+
+        opt->flags[pos] |= OPT_REMOVED;
+        if (jumps) opt->code[jif] = OP_JMP;
+        else opt->flags[jif] |= OPT_REMOVED;
+    }
+}
+
+// Follows chains of unconditional jumps. A jif may only be redirected forward,
+// and every new offset must still fit in its byte; offsets never grow when
+// the code is compacted afterwards.
+static void thread_jumps(optimizer_t *opt)
+{
+    for (uint32_t pos = 0; pos < opt->len; pos = next_inst(opt, pos))
+    {
+        uint8_t op = opt->code[pos];
+        if (!is_jump(op) || (opt->flags[pos] & OPT_REMOVED)) continue;
+
+        uint32_t target = skip_removed(opt, opt->target[pos]);
+        for (int hops = 0; hops < MAX_THREAD_HOPS && target < opt->len; hops++)
+        {
+            uint8_t top = opt->code[target];
+            if (top != OP_JMP && top != OP_LOOP) break;
+
+            uint32_t next = skip_removed(opt, opt->target[target]);
+            if (next == target) break;
+            if (op == OP_JIF && next <= pos) break;
+
+            uint32_t operand = pos + 1;
+            uint32_t distance = next > operand ? next - operand : operand - next;
+            if (distance > UINT8_MAX) break;
+            target = next;
+        }
+        opt->target[pos] = target;
+
+        // a jump straight to a return is the return itself
+        if (op == OP_JMP && target < opt->len && is_terminator(opt->code[target]))
+            opt->code[pos] = opt->code[target];
+    }
+}
+
+static void mark_live(optimizer_t *opt)
+{
+    vector_t(uint32_t) work;
+    vector_init(work);
+    vector_push(uint32_t, work, 0);
+
+    while (vector_size(work) > 0)
+    {
+        uint32_t pos = vector_peek(work);
+        vector_pop(work);
+
+        while (pos < opt->len && !(opt->flags[pos] & OPT_LIVE))
+        {
+            opt->flags[pos] |= OPT_LIVE;
+            uint8_t op = opt->code[pos];
+            if (is_terminator(op)) break;
+
+            if (is_jump(op) && !(opt->flags[pos] & OPT_REMOVED))
+            {
+                vector_push(uint32_t, work, skip_removed(opt, opt->target[pos]));
+                if (op != OP_JIF) break;
+            }
+            pos = next_inst(opt, pos);
+        }
+    }
+
+    vector_destroy(work);
+}
+
+static bool is_kept(optimizer_t *opt, uint32_t pos)
+{
+    return (opt->flags[pos] & OPT_LIVE) && !(opt->flags[pos] & OPT_REMOVED);
+}
+
+static uint32_t next_kept(optimizer_t *opt, uint32_t pos)
+{
+    while (pos < opt->len && !is_kept(opt, pos)) pos = next_inst(opt, pos);
+    return pos;
+}
+
+static void remove_jumps_to_next(optimizer_t *opt)
+{
+    for (uint32_t pos = 0; pos < opt->len; pos = next_inst(opt, pos))
+    {
+        if (!is_kept(opt, pos) || opt->code[pos] != OP_JMP) continue;
+        if (next_kept(opt, next_inst(opt, pos)) == next_kept(opt, opt->target[pos]))
+            opt->flags[pos] |= OPT_REMOVED;
+    }
+}
+
+static bool compact(optimizer_t *opt, byte_r *bytecode)
+{
+    // offsets of dropped instructions map to the next kept one
+    uint32_t size = 0;
+    for (uint32_t pos = 0; pos < opt->len; pos = next_inst(opt, pos))
+    {
+        opt->newpos[pos] = size;
+        if (is_kept(opt, pos)) size += op_length((opcode)opt->code[pos]);
+    }
+    opt->newpos[opt->len] = size;
+
+    uint8_t *out = (uint8_t*)malloc(size > 0 ? size : 1);
+    for (uint32_t pos = 0; pos < opt->len; pos = next_inst(opt, pos))
+    {
+        if (!is_kept(opt, pos)) continue;
+
+        uint8_t op = opt->code[pos];
+        uint32_t at = opt->newpos[pos];
+        memcpy(out + at, opt->code + pos, op_length((opcode)op));
+        if (!is_jump(op)) continue;
+
+        uint32_t operand = at + 1;
+        uint32_t target = opt->newpos[next_kept(opt, opt->target[pos])];
+        if (op != OP_JIF) op = target > operand ? OP_JMP : OP_LOOP;
+
+        uint32_t offset = target > operand ? target - operand : operand - target;
+        if (offset > UINT8_MAX || (op == OP_JIF && target <= operand))
+        {
+            free(out);
+            return false;
+        }
+        out[at] = op;
+        out[at + 1] = (uint8_t)offset;
+    }
+
+    memcpy(bytecode->a, out, size);
+    bytecode->n = size;
+    free(out);
+    return true;
+}
+
+void optimize_function(function_t *f)
+{
+    byte_r *bytecode = &f->bytecode;
+    uint32_t len = vector_size(*bytecode);
+    if (len == 0) return;
+
+    optimizer_t opt;
+    // rewritten in a copy so a failure leaves the function untouched
+    opt.code = (uint8_t*)malloc(len);
+    memcpy(opt.code, bytecode->a, len);
+    opt.len = len;
+    opt.flags = (uint8_t*)calloc(len + 1, sizeof(uint8_t));
+    opt.length = (uint8_t*)calloc(len + 1, sizeof(uint8_t));
+    opt.target = (uint32_t*)calloc(len + 1, sizeof(uint32_t));
+    opt.newpos = (uint32_t*)calloc(len + 1, sizeof(uint32_t));
+
+    if (decode(&opt))
+    {
+        fold_constant_branches(&opt, f);
+        thread_jumps(&opt);
+        mark_live(&opt);
+        remove_jumps_to_next(&opt);
+        compact(&opt, bytecode);
+    }
+
+    free(opt.code);
+    free(opt.flags);
+    free(opt.length);
+    free(opt.target);
+    free(opt.newpos);
+}
\ No newline at end of file
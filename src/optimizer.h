@@ -0,0 +1,11 @@
+#ifndef __OPTIMIZER__
+#define __OPTIMIZER__
+
+#include "value.h"
+
+// Rewrites the finished bytecode of f: branches on constant conditions are
+// resolved, jumps to jumps are threaded, unreachable code is removed and the
+// remaining instructions are compacted with their jump offsets fixed up.
+void optimize_function(function_t *f);
+
+#endif
\ No newline at end of file
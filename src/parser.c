@@ -111,15 +111,7 @@ static void parser_error(lexer_t *lexer, token_t token, const char *msg, ...)
 
 static char *substr(const char *s, int offset, int length)
 {
-    char *sub = (char*)calloc(length + 1, sizeof(char));
-    sub[length] = '\0';
-
-    for (int i = 0; i < length; i++)
-    {
-        sub[i] = s[offset + i];
-    }
-
-    return sub;
+    return arena_strndup(ast_arena(), s + offset, length);
 }
 
 static bool parse_required(lexer_t *lexer, token_type type, bool report)
@@ -130,9 +122,8 @@ static bool parse_required(lexer_t *lexer, token_type type, bool report)
         if (report)
         {
             token_t next = lexer_advance(lexer);
-            char *value = substr(lexer->source.buffer, next.offset, next.length);
-            parser_error(lexer, next, "Expected token %s but got value %s\n", token_type_string(type), value);
-            free(value);
+            parser_error(lexer, next, "Expected token %s but got value %.*s\n", token_type_string(type),
+                next.length, lexer->source.buffer + next.offset);
         }
         return false;
     }
@@ -166,6 +157,35 @@ static node_t *parse_str(lexer_t *lexer, token_t token)
     return node_literal_str_new(str, token.length);
 }
 
+// A template is lexed as text chunks ending in ${ (TOK_TEMPLATE_STR) with an
+// expression after each one, closed by the chunk ending in ` (TOK_TEMPLATE_END).
+static node_t *parse_template(lexer_t *lexer, token_t token)
+{
+    node_r *parts = (node_r*)arena_alloc(ast_arena(), sizeof(node_r));
+
+    while (true)
+    {
+        if (token.length > 0) vector_push_arena(node_t*, *parts, parse_str(lexer, token), ast_arena());
+        if (token.type == TOK_TEMPLATE_END) break;
+
+        node_t *expr = parse_expression(lexer);
+        if (expr) vector_push_arena(node_t*, *parts, expr, ast_arena());
+
+        if (lexer_end(lexer) || (!lexer_check(lexer, TOK_TEMPLATE_STR) && !lexer_check(lexer, TOK_TEMPLATE_END)))
+        {
+            parser_error(lexer, lexer_previous(lexer), "Expected } to close template expression\n");
+            break;
+        }
+        token = lexer_advance(lexer);
+    }
+
+    if (vector_size(*parts) == 0)
+    {
+        return node_literal_str_new(substr("", 0, 0), 0);
+    }
+    return node_concat_new(parts);
+}
+
 static node_t *parse_bool(lexer_t *lexer, token_t token)
 {
     return node_literal_bool_new(token.type == TOK_TRUE);
@@ -173,7 +193,7 @@ static node_t *parse_bool(lexer_t *lexer, token_t token)
 
 static node_t *parse_array(lexer_t *lexer, token_t token)
 {
-    node_r *items = (node_r*)calloc(1, sizeof(node_r));
+    node_r *items = (node_r*)arena_alloc(ast_arena(), sizeof(node_r));
 
     if (lexer_match(lexer, TOK_CLOSED_BRACKET))
     {
@@ -182,7 +202,7 @@ static node_t *parse_array(lexer_t *lexer, token_t token)
 
     do
     {
-        vector_push(node_t*, *items, parse_expression(lexer));
+        vector_push_arena(node_t*, *items, parse_expression(lexer), ast_arena());
     } while (lexer_match(lexer, TOK_COMMA));
 
     parse_required(lexer, TOK_CLOSED_BRACKET, true);
@@ -210,11 +230,11 @@ static postfix_expr_t *parse_postfix_call(lexer_t *lexer)
         return postfix_call_new(NULL);
     }
 
-    node_r *args = (node_r*)calloc(1, sizeof(node_r));
+    node_r *args = (node_r*)arena_alloc(ast_arena(), sizeof(node_r));
 
     do
     {
-        vector_push(node_t*, *args, parse_expression(lexer));
+        vector_push_arena(node_t*, *args, parse_expression(lexer), ast_arena());
     } while (lexer_match(lexer, TOK_COMMA));
     
     parse_required(lexer, TOK_CLOSED_PAREN, true);
@@ -236,14 +256,14 @@ static postfix_expr_t *parse_postfix_subscript(lexer_t *lexer)
 
 static node_t *parse_postfix(lexer_t *lexer, node_t *node, token_t token)
 {
-    postfix_expr_r *exprs = (postfix_expr_r*)calloc(1, sizeof(postfix_expr_r));
+    postfix_expr_r *exprs = (postfix_expr_r*)arena_alloc(ast_arena(), sizeof(postfix_expr_r));
     vector_init(*exprs);
 
     postfix_expr_t *current = NULL;
     if (token.type == TOK_DOT) current = parse_postfix_access(lexer);
     else if (token.type == TOK_OPEN_PAREN) current = parse_postfix_call(lexer);
     else if (token.type == TOK_OPEN_BRACKET) current = parse_postfix_subscript(lexer);
-    vector_push(postfix_expr_t*, *exprs, current);
+    vector_push_arena(postfix_expr_t*, *exprs, current, ast_arena());
 
     while (lexer_match(lexer, TOK_DOT) || lexer_match(lexer, TOK_OPEN_PAREN)
            || lexer_match(lexer, TOK_OPEN_BRACKET))
@@ -252,7 +272,7 @@ static node_t *parse_postfix(lexer_t *lexer, node_t *node, token_t token)
         if (previous.type == TOK_DOT) current = parse_postfix_access(lexer);
         else if (previous.type == TOK_OPEN_PAREN) current = parse_postfix_call(lexer);
         else if (previous.type == TOK_OPEN_BRACKET) current = parse_postfix_subscript(lexer);
-        vector_push(postfix_expr_t*, *exprs, current);
+        vector_push_arena(postfix_expr_t*, *exprs, current, ast_arena());
     }
 
     return node_postfix_new(node, exprs);
@@ -267,13 +287,13 @@ static node_var_r *parse_func_params(lexer_t *lexer)
 {
     if (lexer_check(lexer, TOK_CLOSED_PAREN)) return NULL;
 
-    node_var_r *params = (node_var_r*)calloc(1, sizeof(node_var_r));
+    node_var_r *params = (node_var_r*)arena_alloc(ast_arena(), sizeof(node_var_r));
 
     if (!lexer_check(lexer, TOK_CLOSED_PAREN))
     {
         do
         {
-            vector_push(node_var_t*, *params, (node_var_t*)parse_expression(lexer));
+            vector_push_arena(node_var_t*, *params, (node_var_t*)parse_expression(lexer), ast_arena());
         } while (lexer_match(lexer, TOK_COMMA));
     }
 
@@ -287,7 +307,7 @@ static node_t *parse_func_expr(lexer_t *lexer, token_t token)
     parse_required(lexer, TOK_CLOSED_PAREN, true);
 
     node_t *body = parse_block(lexer);
-    return node_func_decl_new((token_t){.type = TOK_FUNC}, strdup("{anonymous func}"), params, (node_block_t*)body);
+    return node_func_decl_new((token_t){.type = TOK_FUNC}, arena_strdup(ast_arena(), "{anonymous func}"), params, (node_block_t*)body);
 }
 
 static node_t *parse_unary(lexer_t *lexer, token_t token)
@@ -305,10 +325,10 @@ static node_t *parse_infix(lexer_t *lexer, node_t *node, token_t token)
     if (token_is_op_assign(token))
     {
         token.type = token_op_assign_to_op(token);
-        // This leads to node being double-freed later. As a temporary workaround, assume that
-        // node is always a node_var_t and clone it.
+        // The target appears on both sides of the desugared assignment. Assume that node is
+        // always a node_var_t and give the right side its own copy.
         node_var_t* as_var = (node_var_t*)node;
-        node_var_t* copy = (node_var_t*)node_var_new(as_var->base.token, strdup(as_var->identifier));
+        node_var_t* copy = (node_var_t*)node_var_new(as_var->base.token, arena_strdup(ast_arena(), as_var->identifier));
         right = node_binary_new(token, (node_t*)copy, right);
         token.type = TOK_EQ;
     }
@@ -371,6 +391,8 @@ static void init_parse_rules()
     rules[TOK_INT] = PREFIX_RULE(PREC_LOWEST, parse_num);
     rules[TOK_FLOAT] = PREFIX_RULE(PREC_LOWEST, parse_num);
     rules[TOK_STR] = PREFIX_RULE(PREC_LOWEST, parse_str);
+    rules[TOK_TEMPLATE_STR] = PREFIX_RULE(PREC_LOWEST, parse_template);
+    rules[TOK_TEMPLATE_END] = PREFIX_RULE(PREC_LOWEST, parse_template);
     rules[TOK_IDENTIFIER] = PREFIX_RULE(PREC_LOWEST, parse_identifier);
     rules[TOK_FUNC] = PREFIX_RULE(PREC_LOWEST, parse_func_expr);
 
@@ -554,7 +576,7 @@ static node_t *parse_func_decl(lexer_t *lexer, token_t storage, bool is_operator
     }
 
     token_t token = lexer_previous(lexer);
-    char *ident = is_operator ? strdup(op_to_core_str(token.type)) : 
+    char *ident = is_operator ? arena_strdup(ast_arena(), op_to_core_str(token.type)) : 
         substr(lexer->source.buffer, token.offset, token.length);
 
     parse_required(lexer, TOK_OPEN_PAREN, true);
@@ -564,10 +586,10 @@ static node_t *parse_func_decl(lexer_t *lexer, token_t storage, bool is_operator
     node_t *body = parse_block(lexer);
 
     return node_var_decl_new(token, storage, ident,
-        node_func_decl_new(token, strdup(ident), params, (node_block_t*)body));
+        node_func_decl_new(token, arena_strdup(ast_arena(), ident), params, (node_block_t*)body));
 }
 
-static node_t *parse_class_decl(lexer_t *lexer)
+static node_t *parse_class_decl(lexer_t *lexer, bool is_final)
 {
     if (!parse_required(lexer, TOK_IDENTIFIER, false))
     {
@@ -579,13 +601,32 @@ static node_t *parse_class_decl(lexer_t *lexer)
 
     node_block_t *body = (node_block_t*)parse_block(lexer);
     node_r *decls = body->stmts;
-    free(body);
 
-    return node_class_decl_new(token, ident, decls);
+    return node_class_decl_new(token, ident, decls, is_final);
+}
+
+static node_t *parse_import(lexer_t *lexer)
+{
+    token_t token = lexer_previous(lexer);
+    if (!parse_required(lexer, TOK_STR, false))
+    {
+        parser_error(lexer, lexer_previous(lexer), "Expected the path of the module to import\n");
+        return NULL;
+    }
+    token_t path = lexer_previous(lexer);
+    lexer_match(lexer, TOK_SEMICOLON);
+
+    return node_import_new(token, substr(lexer->source.buffer, path.offset, path.length));
 }
 
 static node_t *parse_decl(lexer_t *lexer)
 {
+    if (lexer_match(lexer, TOK_IMPORT))
+    {
+        parser_error(lexer, lexer_previous(lexer), "Imports are only allowed at the top level of a module\n");
+        return NULL;
+    }
+
     token_t storage = token_none();
     if (lexer_match(lexer, TOK_STATIC))
         storage = lexer_previous(lexer);
@@ -595,14 +636,23 @@ static node_t *parse_decl(lexer_t *lexer)
     if (lexer_match(lexer, TOK_FUNC) || lexer_match(lexer, TOK_OPERATOR))
         return parse_func_decl(lexer, storage, lexer_previous(lexer).type == TOK_OPERATOR);
     if (lexer_match(lexer, TOK_CLASS))
-        return parse_class_decl(lexer);
+        return parse_class_decl(lexer, false);
+    if (lexer_match(lexer, TOK_FINAL))
+    {
+        if (!parse_required(lexer, TOK_CLASS, false))
+        {
+            parser_error(lexer, lexer_previous(lexer), "Only classes can be declared final\n");
+            return NULL;
+        }
+        return parse_class_decl(lexer, true);
+    }
 
     return parse_stmt(lexer);
 }
 
 static node_t *parse_block(lexer_t *lexer)
 {
-    node_r *stmts = (node_r*)calloc(1, sizeof(node_r));
+    node_r *stmts = (node_r*)arena_alloc(ast_arena(), sizeof(node_r));
     vector_init(*stmts);
 
     parse_required(lexer, TOK_OPEN_BRACE, true);
@@ -616,7 +666,7 @@ static node_t *parse_block(lexer_t *lexer)
             lexer->nerrors++;
             goto error;
         }
-        vector_push(node_t*, *stmts, node);
+        vector_push_arena(node_t*, *stmts, node, ast_arena());
         if (lexer_end(lexer))
         {
             report_error("Unexpected end of file while parsing\n");
@@ -635,19 +685,19 @@ node_t *parse(lexer_t *lexer)
 {
     init_parse_rules();
 
-    node_r *stmts = (node_r*)calloc(1, sizeof(node_r));
+    node_r *stmts = (node_r*)arena_alloc(ast_arena(), sizeof(node_r));
     vector_init(*stmts);
 
     while (!lexer_end(lexer))
     {
-        node_t *node = parse_decl(lexer);
+        node_t *node = lexer_match(lexer, TOK_IMPORT) ? parse_import(lexer) : parse_decl(lexer);
         if (!node)
         {
             report_error("Parsed node was null\n");
             lexer->nerrors++;
             break;
         }
-        vector_push(node_t*, *stmts, node);
+        vector_push_arena(node_t*, *stmts, node, ast_arena());
     }
 
     return node_block_new(stmts);
@@ -17,6 +17,8 @@ typedef struct
 {
     node_r context_stack;
 
+    // the class variable whose initializer is being visited
+    node_var_decl_t *field;
 } semantic_t;
 
 static bool whitespace_char(char c)
@@ -92,6 +94,19 @@ static void semantic_error(astwalker_t *self, token_t token, const char *msg, ..
     self->nerrors++;
 }
 
+static void release_symtable(void *symtable)
+{
+    symtable_free((symtable_t*)symtable);
+}
+
+// Symtables hang off the tree, so they are released along with its arena.
+static symtable_t *sema_symtable_new()
+{
+    symtable_t *symtable = symtable_new();
+    arena_defer(ast_arena(), release_symtable, symtable);
+    return symtable;
+}
+
 static void visit_block_global(struct astwalker *self, node_block_t *node)
 {
     for (size_t i = 0; i < vector_size(*node->stmts); i++)
@@ -132,8 +147,7 @@ static void fix_constructor_name(const char *classname, node_var_decl_t *decl)
     {
         if (strcmp(classname, decl->ident) == 0)
         {
-            free((char*)decl->ident);
-            decl->ident = strdup(CORE_CONSTRUCT_STRING);
+            decl->ident = arena_strdup(ast_arena(), CORE_CONSTRUCT_STRING);
         }
     }
 }
@@ -149,7 +163,7 @@ static void visit_class_decl_global(struct astwalker *self, node_class_decl_t *n
     node->idx = symtable_add_local(symtable, node->identifier);
     node->loc = LOC_GLOBAL;
 
-    node->symtable = symtable_new();
+    node->symtable = sema_symtable_new();
     if (node->decls)
     {
         for (size_t i = 0; i < vector_size(*node->decls); i++)
@@ -158,8 +172,8 @@ static void visit_class_decl_global(struct astwalker *self, node_class_decl_t *n
             const char *ident = NULL;
             if (decl->type == NODE_VAR_DECL)
             {
-                ident = ((node_var_decl_t*)decl)->ident;
                 fix_constructor_name(node->identifier, (node_var_decl_t*)decl);
+                ident = ((node_var_decl_t*)decl)->ident;
             }
             else
             {
@@ -173,7 +187,7 @@ static void visit_class_decl_global(struct astwalker *self, node_class_decl_t *n
 
 static bool sema_build_global_symtables(node_t *ast, lexer_t *lexer)
 {
-    symtable_t *globals = symtable_new();
+    symtable_t *globals = sema_symtable_new();
     core_register_semantic(globals);
 
     astwalker_t walker = {
@@ -196,7 +210,8 @@ static bool sema_build_global_symtables(node_t *ast, lexer_t *lexer)
         .visit_postfix = NULL,
         .visit_var = NULL,
         .visit_list = NULL,
-        .visit_literal = NULL
+        .visit_literal = NULL,
+        .visit_concat = NULL
     };
 
     walk_ast(&walker, ast);
@@ -287,7 +302,7 @@ static const char *make_tmp_symbol(symtable_t *symtable, node_t *target, const c
         report_error("Could not make unique identifier\n");
         return NULL;
     }
-    return strdup(buffer);
+    return arena_strdup(ast_arena(), buffer);
 }
 
 static void visit_loop(struct astwalker *self, node_loop_t *node)
@@ -332,11 +347,18 @@ static void visit_var_decl(struct astwalker *self, node_var_decl_t *node)
 
     if (node->init)
     {
-        walk_ast(self, node->init);
+        semantic_t *sema = (semantic_t*)self->data;
+        node_var_decl_t *field = sema->field;
         if (node->init->type == NODE_FUNC_DECL)
         {
             ((node_func_decl_t*)node->init)->parent = node;
         }
+        else if (env_class)
+        {
+            sema->field = node;
+        }
+        walk_ast(self, node->init);
+        sema->field = field;
     }
 
     if (env_func)
@@ -355,17 +377,12 @@ static void visit_var_decl(struct astwalker *self, node_var_decl_t *node)
         node_class_decl_t *c = (node_class_decl_t*)context;
         if (node->init && node->init->type == NODE_FUNC_DECL && strcmp(node->ident, CORE_CONSTRUCT_STRING) == 0)
             c->constructor = node;
-
-        node->idx = node->storage.type == TOK_STATIC ? c->num_staticvars++ : c->num_instvars++;
-        node->loc = LOC_CLASS;
-        symtable_modify_decl(env_symtable, node->ident, node->idx);
-        //printf("env_class: %s, %d, static? %d\n", node->ident, node->idx, node->storage.type == TOK_STATIC);
     }
 }
 
 static void visit_func_decl(struct astwalker *self, node_func_decl_t *node)
 {
-    node->symtable = symtable_new();
+    node->symtable = sema_symtable_new();
     symtable_t *symtable = node->symtable;
     symtable_enter_scope(symtable);
 
@@ -398,8 +415,23 @@ static void visit_func_decl(struct astwalker *self, node_func_decl_t *node)
             "Maximum number of local variables reached in function %s\n", node->identifier);
 }
 
+static bool is_static_decl(node_var_decl_t *decl)
+{
+    return decl->storage.type == TOK_STATIC;
+}
+
 static void visit_class_decl(struct astwalker *self, node_class_decl_t *node)
 {
+    // slots are assigned up front, methods may use members declared after them
+    for (size_t i = 0; i < vector_size(*node->decls); i++)
+    {
+        node_var_decl_t *decl = (node_var_decl_t*)vector_get(*node->decls, i);
+        if (decl->base.type != NODE_VAR_DECL) continue;
+        decl->idx = is_static_decl(decl) ? node->num_staticvars++ : node->num_instvars++;
+        decl->loc = LOC_CLASS;
+        symtable_modify_decl(node->symtable, decl->ident, decl->idx);
+    }
+
     PUSH_CONTEXT((node_t*)node);
     for (size_t i = 0; i < vector_size(*node->decls); i++)
     {
@@ -408,10 +440,57 @@ static void visit_class_decl(struct astwalker *self, node_class_decl_t *node)
     POP_CONTEXT;
 }
 
+// The method of class c that a class variable resolved to, NULL for fields.
+static node_var_decl_t *class_method(node_class_decl_t *c, node_var_t *var)
+{
+    for (size_t i = 0; i < vector_size(*c->decls); i++)
+    {
+        node_var_decl_t *decl = (node_var_decl_t*)vector_get(*c->decls, i);
+        if (decl->base.type == NODE_VAR_DECL && decl->idx == var->idx && strcmp(decl->ident, var->identifier) == 0)
+        {
+            return decl->init && decl->init->type == NODE_FUNC_DECL ? decl : NULL;
+        }
+    }
+    return NULL;
+}
+
+static node_class_decl_t *enclosing_class(astwalker_t *self)
+{
+    node_r context_stack = ((semantic_t*)self->data)->context_stack;
+    for (int i = vector_size(context_stack) - 1; i >= 0; i--)
+    {
+        node_t *context = vector_get(context_stack, i);
+        if (context->type == NODE_CLASS_DECL) return (node_class_decl_t*)context;
+    }
+    return NULL;
+}
+
 static void visit_binary(struct astwalker *self, node_binary_t *node)
 {
     walk_ast(self, node->left);
     walk_ast(self, node->right);
+
+    // the importing module must not break what type inference proved about
+    // the globals of the module that declares them
+    if (node->op.type == TOK_EQ && node->left->type == NODE_VAR)
+    {
+        node_var_t *var = (node_var_t*)node->left;
+        symtable_t *globals = node_get_symtable(vector_get(((semantic_t*)self->data)->context_stack, 0));
+        decl_info_t decl;
+        if (var->location == LOC_GLOBAL && symtable_lookup(globals, var->identifier, &decl) && decl.is_import)
+        {
+            semantic_error(self, var->base.token, "Cannot assign to %s, it is declared by an imported module\n",
+                var->identifier);
+        }
+
+        // calls between the methods of a final class are bound to them directly
+        node_class_decl_t *c = var->location == LOC_CLASS ? enclosing_class(self) : NULL;
+        if (c && c->is_final && class_method(c, var))
+        {
+            semantic_error(self, var->base.token, "Cannot assign to %s, it is a method of final class %s\n",
+                var->identifier, c->identifier);
+        }
+    }
 }
 
 static void visit_unary(struct astwalker *self, node_unary_t *node)
@@ -419,6 +498,38 @@ static void visit_unary(struct astwalker *self, node_unary_t *node)
     walk_ast(self, node->right);
 }
 
+// A method or field initializer calling a sibling method by its bare name
+// calls it on its own object.
+static void bind_self_call(astwalker_t *self, node_postfix_t *node)
+{
+    if (node->target->type != NODE_VAR || vector_get(*node->exprs, 0)->type != POST_CALL) return;
+
+    node_var_t *var = (node_var_t*)node->target;
+    node_r context_stack = ((semantic_t*)self->data)->context_stack;
+    uint16_t len = vector_size(context_stack);
+    if (var->location != LOC_CLASS || len < 2) return;
+
+    node_t *caller = vector_get(context_stack, len - 1);
+    node_t *context = vector_get(context_stack, len - 2);
+    node_var_decl_t *caller_decl = NULL;
+    if (caller->type == NODE_CLASS_DECL)
+    {
+        context = caller;
+        caller_decl = ((semantic_t*)self->data)->field;
+    }
+    else if (caller->type == NODE_FUNC_DECL && context->type == NODE_CLASS_DECL)
+    {
+        caller_decl = ((node_func_decl_t*)caller)->parent;
+    }
+    if (!caller_decl) return;
+
+    node_class_decl_t *c = (node_class_decl_t*)context;
+    node_var_decl_t *method = class_method(c, var);
+    if (!method || is_static_decl(method) != is_static_decl(caller_decl)) return;
+
+    node->binding = c->is_final ? BIND_DIRECT : BIND_SELF;
+}
+
 static void visit_postfix(struct astwalker *self, node_postfix_t *node)
 {
     for (size_t i = 0; i < vector_size(*node->exprs); i++)
@@ -442,6 +553,7 @@ static void visit_postfix(struct astwalker *self, node_postfix_t *node)
 
 
     walk_ast(self, node->target);
+    bind_self_call(self, node);
 }
 
 static uint8_t add_upvalue(node_func_decl_t *f, uint16_t distance, decl_info_t decl, const char *symbol)
@@ -453,8 +565,8 @@ static uint8_t add_upvalue(node_func_decl_t *f, uint16_t distance, decl_info_t d
         if (strcmp(symbol, upvalue.symbol) == 0) return i;
     }
 
-    vector_push(ast_upvalue_t, *upvalues,
-        ((ast_upvalue_t){.is_direct = distance == 2, .idx = decl.idx, .symbol = symbol }));
+    vector_push_arena(ast_upvalue_t, *upvalues,
+        ((ast_upvalue_t){.is_direct = distance == 2, .idx = decl.idx, .symbol = symbol }), ast_arena());
     return vector_size(*upvalues) - 1;
 }
 
@@ -536,6 +648,14 @@ static void visit_list(struct astwalker *self, node_list_t *node)
     }
 }
 
+static void visit_concat(struct astwalker *self, node_concat_t *node)
+{
+    for (size_t i = 0; i < vector_size(*node->parts); i++)
+    {
+        walk_ast(self, vector_get(*node->parts, i));
+    }
+}
+
 static void visit_range(struct astwalker *self, node_range_t *node)
 {
     if (node->start->type == NODE_LITERAL)
@@ -553,6 +673,7 @@ static bool sema_build_local_symtables(node_t *ast, lexer_t *lexer)
 {
     semantic_t sema;
     vector_init(sema.context_stack);
+    sema.field = NULL;
 
     astwalker_t walker = {
         .nerrors = 0,
@@ -575,7 +696,8 @@ static bool sema_build_local_symtables(node_t *ast, lexer_t *lexer)
         .visit_var = visit_var,
         .visit_list = visit_list,
         .visit_range = visit_range,
-        .visit_literal = NULL
+        .visit_literal = NULL,
+        .visit_concat = visit_concat
     };
 
     ((node_block_t*)ast)->is_root = true;
@@ -584,10 +706,425 @@ static bool sema_build_local_symtables(node_t *ast, lexer_t *lexer)
     return walker.nerrors == 0;
 }
 
-bool semantic_process(node_t *ast, lexer_t *lexer)
+// Type inference. Every local and global slot that is only ever written by
+// its declarations and plain assignments gets the join of the types of all
+// the values stored into it, iterated to a fixpoint so `i = i + 1` keeps an
+// int counter an int. Slots that can be written any other way (parameters,
+// for-in variables, captured locals, functions and classes) stay unknown.
+// Binary expressions whose operands are then proven int or float are marked
+// so codegen can emit opcodes without tag checks. A global holds null until
+// its declaration runs, so it is only typed where it is read after the
+// declaration, counting a function or class body as read where it is declared.
+
+typedef enum
+{
+    TYPE_NONE, TYPE_INT, TYPE_FLOAT, TYPE_BOOL, TYPE_STR, TYPE_ANY
+} infer_type;
+
+typedef struct
+{
+    infer_type type;
+    bool declared;
+    bool pinned;
+} infer_slot_t;
+
+typedef struct
+{
+    infer_slot_t slots[MAX_LOCALS + 1];
+} infer_scope_t;
+
+typedef struct
+{
+    infer_scope_t *scope;
+    uint8_t idx;
+    node_t *value;
+    uint32_t pos;
+} infer_write_t;
+
+typedef struct
+{
+    vector_t(infer_scope_t*) scopes;
+    vector_t(infer_scope_t*) stack;
+    vector_t(infer_write_t) writes;
+    infer_scope_t *globals;
+    uint32_t declared_at[MAX_LOCALS + 1];
+    uint32_t pos;           // number of global declarations visited so far
+    bool annotate;
+    size_t next_scope;      // functions are visited in the same order by both walks
+} infer_t;
+
+#define INFER ((infer_t*)self->data)
+#define INFER_SCOPE vector_peek(INFER->stack)
+
+static infer_type infer_join(infer_type a, infer_type b)
+{
+    if (a == TYPE_NONE) return b;
+    if (b == TYPE_NONE || a == b) return a;
+    return TYPE_ANY;
+}
+
+static infer_slot_t *infer_slot(infer_t *infer, infer_scope_t *scope, location_e loc, uint8_t idx)
+{
+    if (loc == LOC_GLOBAL) return &infer->globals->slots[idx];
+    if (loc == LOC_LOCAL && scope) return &scope->slots[idx];
+    return NULL;
+}
+
+static bool is_numeric(infer_type type)
+{
+    return type == TYPE_INT || type == TYPE_FLOAT;
+}
+
+static infer_type infer_expr(infer_t *infer, infer_scope_t *scope, node_t *node);
+
+// Mirrors the vm: fast arithmetic keeps int with int and promotes to float,
+// % only has an int fast path, comparisons of numbers and && / || give bools.
+static infer_type infer_binary(infer_t *infer, infer_scope_t *scope, node_binary_t *node)
+{
+    if (node->op.type == TOK_EQ) return infer_expr(infer, scope, node->right);
+    if (node->op.type == TOK_AND || node->op.type == TOK_OR) return TYPE_BOOL;
+
+    infer_type l = infer_expr(infer, scope, node->left);
+    infer_type r = infer_expr(infer, scope, node->right);
+    if (node->op.type == TOK_ADD && l == TYPE_STR) return TYPE_STR;
+    if (l == TYPE_NONE || r == TYPE_NONE) return TYPE_NONE;
+    if (!is_numeric(l) || !is_numeric(r)) return TYPE_ANY;
+
+    switch (node->op.type)
+    {
+    case TOK_ADD: case TOK_SUB: case TOK_MUL: case TOK_DIV:
+        return l == TYPE_INT && r == TYPE_INT ? TYPE_INT : TYPE_FLOAT;
+    case TOK_MOD:
+        return l == TYPE_INT && r == TYPE_INT ? TYPE_INT : TYPE_ANY;
+    case TOK_LT: case TOK_GT: case TOK_LTE: case TOK_GTE: case TOK_EQEQ: case TOK_NEQ:
+        return TYPE_BOOL;
+    default:
+        return TYPE_ANY;
+    }
+}
+
+static infer_type infer_expr(infer_t *infer, infer_scope_t *scope, node_t *node)
+{
+    if (!node) return TYPE_ANY;
+
+    switch (node->type)
+    {
+    case NODE_LITERAL:
+    {
+        switch (((node_literal_t*)node)->type)
+        {
+        case LITERAL_INT: return TYPE_INT;
+        case LITERAL_FLT: return TYPE_FLOAT;
+        case LITERAL_BOOL: return TYPE_BOOL;
+        case LITERAL_STR: return TYPE_STR;
+        }
+        return TYPE_ANY;
+    }
+    case NODE_VAR:
+    {
+        node_var_t *var = (node_var_t*)node;
+        infer_slot_t *slot = infer_slot(infer, scope, var->location, var->idx);
+        if (!slot || !slot->declared || slot->pinned) return TYPE_ANY;
+        if (var->location == LOC_GLOBAL && infer->declared_at[var->idx] >= infer->pos) return TYPE_ANY;
+        return slot->type;
+    }
+    case NODE_BINARY:
+        return infer_binary(infer, scope, (node_binary_t*)node);
+    case NODE_UNARY:
+    {
+        node_unary_t *unary = (node_unary_t*)node;
+        infer_type type = infer_expr(infer, scope, unary->right);
+        if (type == TYPE_NONE) return TYPE_NONE;
+        if (unary->op.type == TOK_BANG) return type == TYPE_BOOL ? TYPE_BOOL : TYPE_ANY;
+        return is_numeric(type) ? type : TYPE_ANY;
+    }
+    case NODE_CONCAT:
+        return TYPE_STR;
+    default:
+        return TYPE_ANY;
+    }
+}
+
+static void infer_write(astwalker_t *self, location_e loc, uint8_t idx, node_t *value, bool declares)
+{
+    infer_scope_t *scope = loc == LOC_GLOBAL ? INFER->globals : INFER_SCOPE;
+    infer_slot_t *slot = infer_slot(INFER, scope, loc, idx);
+    if (!slot) return;
+
+    if (declares) slot->declared = true;
+    if (!value) slot->pinned = true;
+    else vector_push(infer_write_t, INFER->writes, ((infer_write_t){ scope, idx, value, INFER->pos }));
+}
+
+static void infer_pin(astwalker_t *self, location_e loc, uint8_t idx)
+{
+    infer_slot_t *slot = infer_slot(INFER, INFER_SCOPE, loc, idx);
+    if (slot) slot->pinned = true;
+}
+
+static void infer_visit_nodes(astwalker_t *self, node_r *nodes)
+{
+    if (!nodes) return;
+    for (size_t i = 0; i < vector_size(*nodes); i++)
+    {
+        node_t *node = vector_get(*nodes, i);
+        if (node) walk_ast(self, node);
+    }
+}
+
+static void infer_visit_block(astwalker_t *self, node_block_t *node)
+{
+    infer_visit_nodes(self, node->stmts);
+}
+
+static void infer_visit_if(astwalker_t *self, node_if_t *node)
+{
+    walk_ast(self, node->cond);
+    walk_ast(self, node->then);
+    if (node->els) walk_ast(self, node->els);
+}
+
+static void infer_visit_loop(astwalker_t *self, node_loop_t *node)
+{
+    if (node->init) walk_ast(self, node->init);
+    if (node->cond) walk_ast(self, node->cond);
+    if (node->inc) walk_ast(self, node->inc);
+    walk_ast(self, node->body);
+
+    if (node->type == LOOP_FORIN && !INFER->annotate)
+    {
+        // written by the iterator protocol, not by an expression
+        node_var_decl_t *val = (node_var_decl_t*)node->init;
+        infer_pin(self, val->loc, val->idx);
+        infer_pin(self, node->loc, node->target_idx);
+        infer_pin(self, node->loc, node->it_idx);
+    }
+}
+
+static void infer_visit_return(astwalker_t *self, node_return_t *node)
+{
+    if (node->expr) walk_ast(self, node->expr);
+}
+
+static void infer_visit_var_decl(astwalker_t *self, node_var_decl_t *node)
+{
+    if (node->init) walk_ast(self, node->init);
+    if (node->loc == LOC_GLOBAL)
+    {
+        // only reads visited from here on see the declared value, the
+        // first declaration counts when several share the slot
+        if (!INFER->annotate && INFER->declared_at[node->idx] == UINT32_MAX)
+            INFER->declared_at[node->idx] = INFER->pos;
+        INFER->pos++;
+    }
+    if (INFER->annotate) return;
+
+    bool is_func = node->init && node->init->type == NODE_FUNC_DECL;
+    infer_write(self, node->loc, node->idx, is_func ? NULL : node->init, true);
+}
+
+static void infer_visit_func_decl(astwalker_t *self, node_func_decl_t *node)
+{
+    infer_scope_t *scope = NULL;
+    if (INFER->annotate)
+    {
+        scope = vector_get(INFER->scopes, INFER->next_scope++);
+    }
+    else
+    {
+        // a captured local can be assigned from the closure
+        for (size_t i = 0; node->upvalues && i < vector_size(*node->upvalues); i++)
+        {
+            ast_upvalue_t upvalue = vector_get(*node->upvalues, i);
+            if (upvalue.is_direct) infer_pin(self, LOC_LOCAL, upvalue.idx);
+        }
+
+        scope = (infer_scope_t*)calloc(1, sizeof(infer_scope_t));
+        vector_push(infer_scope_t*, INFER->scopes, scope);
+    }
+
+    vector_push(infer_scope_t*, INFER->stack, scope);
+    infer_visit_block(self, node->body);
+    vector_pop(INFER->stack);
+}
+
+static void infer_visit_class_decl(astwalker_t *self, node_class_decl_t *node)
+{
+    if (!INFER->annotate) infer_pin(self, node->loc, node->idx);
+    infer_visit_nodes(self, node->decls);
+}
+
+static void infer_visit_binary(astwalker_t *self, node_binary_t *node)
+{
+    walk_ast(self, node->left);
+    walk_ast(self, node->right);
+
+    if (!INFER->annotate)
+    {
+        if (node->op.type == TOK_EQ && node->left->type == NODE_VAR)
+        {
+            node_var_t *var = (node_var_t*)node->left;
+            infer_write(self, var->location, var->idx, node->right, false);
+        }
+        return;
+    }
+
+    if (node->op.type == TOK_EQ || node->op.type == TOK_AND || node->op.type == TOK_OR) return;
+
+    infer_type l = infer_expr(INFER, INFER_SCOPE, node->left);
+    infer_type r = infer_expr(INFER, INFER_SCOPE, node->right);
+    if (l == TYPE_INT && r == TYPE_INT) node->operands = OPERANDS_INT;
+    else if (l == TYPE_FLOAT && r == TYPE_FLOAT && node->op.type != TOK_MOD) node->operands = OPERANDS_FLOAT;
+}
+
+static void infer_visit_unary(astwalker_t *self, node_unary_t *node)
+{
+    walk_ast(self, node->right);
+}
+
+static void infer_visit_postfix(astwalker_t *self, node_postfix_t *node)
+{
+    walk_ast(self, node->target);
+    for (size_t i = 0; node->exprs && i < vector_size(*node->exprs); i++)
+    {
+        postfix_expr_t *expr = vector_get(*node->exprs, i);
+        if (expr->type == POST_CALL) infer_visit_nodes(self, expr->args);
+        else if (expr->type == POST_SUBSCRIPT) walk_ast(self, expr->accessor);
+    }
+}
+
+static void infer_visit_list(astwalker_t *self, node_list_t *node)
+{
+    infer_visit_nodes(self, node->items);
+}
+
+static void infer_visit_range(astwalker_t *self, node_range_t *node)
+{
+    walk_ast(self, node->start);
+    walk_ast(self, node->end);
+}
+
+static void infer_visit_concat(astwalker_t *self, node_concat_t *node)
+{
+    infer_visit_nodes(self, node->parts);
+}
+
+static void sema_infer_types(node_t *ast)
+{
+    infer_t infer;
+    vector_init(infer.scopes);
+    vector_init(infer.stack);
+    vector_init(infer.writes);
+    infer.globals = (infer_scope_t*)calloc(1, sizeof(infer_scope_t));
+    memset(infer.declared_at, 0xff, sizeof(infer.declared_at));
+    infer.pos = 0;
+    infer.annotate = false;
+    infer.next_scope = 0;
+    vector_push(infer_scope_t*, infer.stack, NULL);
+
+    astwalker_t walker = {
+        .data = (void*)&infer,
+
+        .visit_block = infer_visit_block,
+        .visit_if = infer_visit_if,
+        .visit_loop = infer_visit_loop,
+        .visit_return = infer_visit_return,
+
+        .visit_var_decl = infer_visit_var_decl,
+        .visit_func_decl = infer_visit_func_decl,
+        .visit_class_decl = infer_visit_class_decl,
+
+        .visit_binary = infer_visit_binary,
+        .visit_unary = infer_visit_unary,
+        .visit_postfix = infer_visit_postfix,
+        .visit_var = NULL,
+        .visit_list = infer_visit_list,
+        .visit_range = infer_visit_range,
+        .visit_literal = NULL,
+        .visit_concat = infer_visit_concat
+    };
+    walk_ast(&walker, ast);
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < vector_size(infer.writes); i++)
+        {
+            infer_write_t write = vector_get(infer.writes, i);
+            infer_slot_t *slot = &write.scope->slots[write.idx];
+            infer.pos = write.pos;
+            infer_type type = infer_join(slot->type, infer_expr(&infer, write.scope, write.value));
+            if (type != slot->type)
+            {
+                slot->type = type;
+                changed = true;
+            }
+        }
+    }
+
+    infer.annotate = true;
+    infer.pos = 0;
+    walk_ast(&walker, ast);
+
+    for (size_t i = 0; i < vector_size(infer.scopes); i++)
+    {
+        free(vector_get(infer.scopes, i));
+    }
+    vector_destroy(infer.scopes);
+    vector_destroy(infer.stack);
+    vector_destroy(infer.writes);
+    free(infer.globals);
+}
+
+bool semantic_declare(node_t *ast, lexer_t *lexer)
+{
+    return sema_build_global_symtables(ast, lexer);
+}
+
+bool semantic_import(node_t *ast, lexer_t *lexer, node_import_t *import)
+{
+    astwalker_t walker = { .nerrors = 0, .data2 = (void*)lexer };
+    symtable_t *globals = ((node_block_t*)ast)->symtable;
+    node_r *stmts = import->module->stmts;
+
+    for (size_t i = 0; i < vector_size(*stmts); i++)
+    {
+        node_t *stmt = vector_get(*stmts, i);
+        const char *ident = NULL;
+        uint8_t idx = 0;
+        if (stmt->type == NODE_VAR_DECL)
+        {
+            ident = ((node_var_decl_t*)stmt)->ident;
+            idx = ((node_var_decl_t*)stmt)->idx;
+        }
+        else if (stmt->type == NODE_CLASS_DECL)
+        {
+            ident = ((node_class_decl_t*)stmt)->identifier;
+            idx = ((node_class_decl_t*)stmt)->idx;
+        }
+        else continue;
+
+        // the module's own declarations take precedence over imported ones
+        decl_info_t decl;
+        if (symtable_lookup(globals, ident, &decl))
+        {
+            if (decl.is_import)
+                semantic_error(&walker, import->base.token, "%s is imported from more than one module\n", ident);
+            continue;
+        }
+        ast_import_t name = { .idx = symtable_add_import(globals, ident), .module_idx = idx };
+        vector_push_arena(ast_import_t, *import->names, name, ast_arena());
+    }
+
+    return walker.nerrors == 0;
+}
+
+bool semantic_resolve(node_t *ast, lexer_t *lexer)
 {
-    if (!sema_build_global_symtables(ast, lexer))
+    if (!sema_build_local_symtables(ast, lexer))
         return false;
 
-    return sema_build_local_symtables(ast, lexer);
+    sema_infer_types(ast);
+    return true;
 }
\ No newline at end of file
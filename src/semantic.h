@@ -6,6 +6,12 @@
 #include "ast.h"
 #include "lexer.h"
 
-bool semantic_process(node_t *ast, lexer_t *lexer);
+// Analysis of one module, run by the compiler driver in three steps: declare
+// the module's top level names, bring in the top level names of each module
+// it imports, then resolve every other name and infer types. Only the import
+// step looks at another module, the other two may run on any thread.
+bool semantic_declare(node_t *ast, lexer_t *lexer);
+bool semantic_import(node_t *ast, lexer_t *lexer, node_import_t *import);
+bool semantic_resolve(node_t *ast, lexer_t *lexer);
 
 #endif
\ No newline at end of file
@@ -3,103 +3,130 @@
 #include <string.h>
 #include <stdio.h>
 
+#include "hash.h"
+
+#define SYMTABLE_MIN_BUCKETS 16
+
+#define SCOPE_START(table, level) vector_get((table)->scopes, (level))
+
+static void symtable_rehash(symtable_t *table, uint32_t nbuckets)
+{
+    table->buckets = (int32_t*)realloc(table->buckets, nbuckets * sizeof(int32_t));
+    table->nbuckets = nbuckets;
+    memset(table->buckets, 0xff, nbuckets * sizeof(int32_t));
+
+    // relinking in declaration order keeps the newest entry at the head of each bucket
+    for (size_t i = 0; i < vector_size(table->entries); i++)
+    {
+        symtable_entry_t *entry = &vector_get(table->entries, i);
+        int32_t *head = &table->buckets[entry->hash & (nbuckets - 1)];
+        entry->next = *head;
+        *head = (int32_t)i;
+    }
+}
+
+static symtable_entry_t *symtable_find(symtable_t *table, const char *symbol)
+{
+    uint32_t hash = hash_string(symbol);
+    int32_t i = table->buckets[hash & (table->nbuckets - 1)];
+    while (i >= 0)
+    {
+        symtable_entry_t *entry = &vector_get(table->entries, i);
+        if (entry->hash == hash && strcmp(symbol, entry->identifier) == 0) return entry;
+        i = entry->next;
+    }
+    return NULL;
+}
+
 symtable_t *symtable_new()
 {
     symtable_t *table = (symtable_t*)calloc(1, sizeof(symtable_t));
-    vector_init(table->stack);
+    vector_init(table->entries);
+    vector_init(table->scopes);
+    vector_push(uint32_t, table->scopes, 0);
     table->top = 0;
-    symtable_entry_r *first_scope = (symtable_entry_r*)calloc(1, sizeof(symtable_entry_r));
-    vector_init(*first_scope);
-    vector_push(symtable_entry_r*, table->stack, first_scope);
+    symtable_rehash(table, SYMTABLE_MIN_BUCKETS);
     return table;
 }
 
 void symtable_free(symtable_t *table)
 {
-    for (size_t i = 0; i <= table->top; i++)
-    {
-        vector_destroy(*vector_get(table->stack, i));
-        free(vector_get(table->stack, i));
-    }
-    vector_destroy(table->stack);
+    vector_destroy(table->entries);
+    vector_destroy(table->scopes);
+    free(table->buckets);
     free(table);
 }
 
 bool symtable_lookup(symtable_t *table, const char *symbol, decl_info_t *ret)
 {
-    for (int j = table->top; j >= 0; j--)
-    {
-        symtable_entry_r *scope = vector_get(table->stack, j);
-        for (size_t i = 0; i < vector_size(*scope); i++)
-        {
-            symtable_entry_t entry = vector_get(*scope, i);
-            if (strcmp(symbol, entry.identifier) == 0)
-            {
-                if (ret) *ret = entry.decl;
-                return true;
-            }
-        }
-    }
-    return false;
+    symtable_entry_t *entry = symtable_find(table, symbol);
+    if (!entry) return false;
+
+    if (ret) *ret = entry->decl;
+    return true;
 }
 
-uint8_t symtable_add_local(symtable_t *table, const char *symbol)
+static uint8_t symtable_add(symtable_t *table, const char *symbol, bool is_import)
 {
-    decl_info_t decl;
-    if (symtable_lookup(table, symbol, &decl))
-        return decl.idx;
+    symtable_entry_t *found = symtable_find(table, symbol);
+    if (found) return found->decl.idx;
 
-    symtable_entry_r *scope = vector_get(table->stack, table->top);
+    decl_info_t decl;
     decl.is_global = symtable_is_global(table);
-    decl.idx = vector_size(*scope) + symtable_nvars(table);
+    decl.is_import = is_import;
+    decl.idx = vector_size(table->entries);
     decl.level = table->top;
-    vector_push(symtable_entry_t, *scope, ((symtable_entry_t){ .identifier = symbol, .decl = decl}));
+
+    uint32_t hash = hash_string(symbol);
+    int32_t *head = &table->buckets[hash & (table->nbuckets - 1)];
+    symtable_entry_t entry = { .identifier = symbol, .hash = hash, .next = *head, .decl = decl };
+    *head = (int32_t)vector_size(table->entries);
+    vector_push(symtable_entry_t, table->entries, entry);
+
+    if (vector_size(table->entries) > table->nbuckets) symtable_rehash(table, table->nbuckets << 1);
     return decl.idx;
 }
 
+uint8_t symtable_add_local(symtable_t *table, const char *symbol)
+{
+    return symtable_add(table, symbol, false);
+}
+
+uint8_t symtable_add_import(symtable_t *table, const char *symbol)
+{
+    return symtable_add(table, symbol, true);
+}
+
 void symtable_modify_decl(symtable_t * table, const char * symbol, uint8_t idx)
 {
-    for (int j = table->top; j >= 0; j--)
-    {
-        symtable_entry_r *scope = vector_get(table->stack, j);
-        for (size_t i = 0; i < vector_size(*scope); i++)
-        {
-            symtable_entry_t *entry = &vector_get(*scope, i);
-            if (strcmp(symbol, entry->identifier) == 0)
-            {
-                entry->decl.idx = idx;
-                return;
-            }
-        }
-    }
+    symtable_entry_t *entry = symtable_find(table, symbol);
+    if (entry) entry->decl.idx = idx;
 }
 
 uint8_t symtable_nvars(symtable_t *table)
 {
-    uint8_t nvars = 0;
-    for (size_t i = 0; i < table->top; i++)
-    {
-        symtable_entry_r *scope = vector_get(table->stack, i);
-        nvars += vector_size(*scope);
-    }
-    return nvars;
+    return SCOPE_START(table, table->top);
 }
 
 void symtable_enter_scope(symtable_t *table)
 {
     table->top++;
-    symtable_entry_r *new_scope = (symtable_entry_r*)calloc(1, sizeof(symtable_entry_r));
-    vector_init(*new_scope);
-    vector_push(symtable_entry_r*, table->stack, new_scope);
+    vector_push(uint32_t, table->scopes, vector_size(table->entries));
 }
 
 uint32_t symtable_exit_scope(symtable_t *table)
 {
-    symtable_entry_r *scope = vector_get(table->stack, table->top);
-    uint32_t nlocals = vector_size(*scope);
-    vector_destroy(*scope);
-    free(scope);
-    vector_pop(table->stack);
+    uint32_t start = SCOPE_START(table, table->top);
+    uint32_t nlocals = vector_size(table->entries) - start;
+
+    while (vector_size(table->entries) > start)
+    {
+        symtable_entry_t *entry = &vector_peek(table->entries);
+        table->buckets[entry->hash & (table->nbuckets - 1)] = entry->next;
+        vector_pop(table->entries);
+    }
+
+    vector_pop(table->scopes);
     table->top--;
     return nlocals;
 }
@@ -112,10 +139,9 @@ bool symtable_is_global(symtable_t *table)
 void symtable_dump(symtable_t *table)
 {
     printf("----Dumping symtable----\n");
-    symtable_entry_r *scope = vector_get(table->stack, table->top);
-    for (size_t i = 0; i < vector_size(*scope); i++)
+    for (size_t i = SCOPE_START(table, table->top); i < vector_size(table->entries); i++)
     {
-        printf("%s\n", vector_get(*scope, i).identifier);
+        printf("%s\n", vector_get(table->entries, i).identifier);
     }
     printf("----\n");
 }
\ No newline at end of file
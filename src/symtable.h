@@ -9,6 +9,8 @@
 typedef struct
 {
     bool is_global;
+    // declared by another module, see symtable_add_import
+    bool is_import;
     uint8_t idx;
     uint8_t level;
 } decl_info_t;
@@ -16,15 +18,24 @@ typedef struct
 typedef struct
 {
     const char *identifier;
+    uint32_t hash;
+    // previous entry in the same bucket, or -1
+    int32_t next;
     decl_info_t decl;
 } symtable_entry_t;
 
 typedef vector_t(symtable_entry_t) symtable_entry_r;
 
+// All visible declarations live in one array, in declaration order, and are
+// chained into hash buckets. A scope is the range of entries starting at its
+// offset in scopes, so leaving a scope only has to unlink the newest entries,
+// which are always at the head of their bucket.
 typedef struct symtable_t
 {
-    // linear search for now
-    vector_t(symtable_entry_r*) stack;
+    symtable_entry_r entries;
+    vector_t(uint32_t) scopes;
+    int32_t *buckets;
+    uint32_t nbuckets;
     uint32_t top;
 } symtable_t;
 
@@ -33,6 +44,7 @@ void symtable_free(symtable_t *table);
 
 bool symtable_lookup(symtable_t *table, const char *symbol, decl_info_t *ret);
 uint8_t symtable_add_local(symtable_t *table, const char *symbol);
+uint8_t symtable_add_import(symtable_t *table, const char *symbol);
 void symtable_modify_decl(symtable_t *table, const char *symbol, uint8_t idx);
 uint8_t symtable_nvars(symtable_t *table);
 void symtable_enter_scope(symtable_t *table);
@@ -0,0 +1,84 @@
+#include "threads.h"
+
+#include <stdlib.h>
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+#include <Windows.h>
+#define THREADS_WINDOWS
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+typedef struct
+{
+    thread_work work;
+    void *data;
+} thread_start_t;
+
+#ifdef THREADS_WINDOWS
+static DWORD WINAPI thread_main(LPVOID arg)
+#else
+static void *thread_main(void *arg)
+#endif
+{
+    thread_start_t *start = (thread_start_t*)arg;
+    start->work(start->data);
+    return 0;
+}
+
+uint32_t threads_available()
+{
+#ifdef THREADS_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long n = (long)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n > 0 ? (uint32_t)n : 1;
+}
+
+void threads_run(uint32_t nthreads, thread_work work, void *data)
+{
+    thread_start_t start = { .work = work, .data = data };
+    uint32_t nspawned = 0;
+
+#ifdef THREADS_WINDOWS
+    HANDLE *threads = (HANDLE*)malloc(nthreads * sizeof(HANDLE));
+    for (uint32_t i = 1; i < nthreads; i++)
+    {
+        HANDLE thread = CreateThread(NULL, 0, thread_main, &start, 0, NULL);
+        if (thread) threads[nspawned++] = thread;
+    }
+#else
+    pthread_t *threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+    for (uint32_t i = 1; i < nthreads; i++)
+    {
+        if (pthread_create(&threads[nspawned], NULL, thread_main, &start) == 0) nspawned++;
+    }
+#endif
+
+    // a thread that could not be started only means less parallelism
+    work(data);
+
+    for (uint32_t i = 0; i < nspawned; i++)
+    {
+#ifdef THREADS_WINDOWS
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+    free(threads);
+}
+
+uint32_t threads_claim(volatile uint32_t *counter)
+{
+#ifdef THREADS_WINDOWS
+    return (uint32_t)InterlockedIncrement((volatile LONG*)counter) - 1;
+#else
+    return __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+#endif
+}
\ No newline at end of file
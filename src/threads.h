@@ -0,0 +1,25 @@
+#ifndef __THREADS__
+#define __THREADS__
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+typedef void (*thread_work)(void *data);
+
+// Number of threads the machine can run at once, at least 1.
+uint32_t threads_available();
+
+// Runs work(data) on nthreads threads, the calling thread being one of them,
+// and returns once every call has returned. Work is shared out by the callee,
+// typically through threads_claim on a counter in data.
+void threads_run(uint32_t nthreads, thread_work work, void *data);
+
+// Atomically increments counter and returns its previous value.
+uint32_t threads_claim(volatile uint32_t *counter);
+
+#endif
\ No newline at end of file
@@ -114,6 +114,8 @@ const char *token_type_string(token_type type)
     case TOK_INT: return "int";
     case TOK_FLOAT: return "float";
     case TOK_STR: return "string";
+    case TOK_TEMPLATE_STR: return "template string";
+    case TOK_TEMPLATE_END: return "template end";
 
     case TOK_IDENTIFIER: return "identifier";
     case TOK_VAR: return "var";
@@ -129,6 +131,8 @@ const char *token_type_string(token_type type)
     case TOK_RETURN: return "return";
     case TOK_STATIC: return "static";
     case TOK_OPERATOR: return "operator";
+    case TOK_IMPORT: return "import";
+    case TOK_FINAL: return "final";
     default: return "token";
     }
 }
@@ -11,13 +11,13 @@ typedef enum
     TOK_OPEN_PAREN, TOK_CLOSED_PAREN, TOK_SEMICOLON, TOK_COMMA, TOK_OPEN_BRACE, 
     TOK_CLOSED_BRACE, TOK_OPEN_BRACKET, TOK_CLOSED_BRACKET, TOK_DOT,
     
-    TOK_INT, TOK_FLOAT, TOK_STR, 
+    TOK_INT, TOK_FLOAT, TOK_STR, TOK_TEMPLATE_STR, TOK_TEMPLATE_END,
     TOK_TRUE, TOK_FALSE, 
     
     TOK_IDENTIFIER, 
     TOK_VAR, TOK_CLASS,
     TOK_IF, TOK_ELSE, TOK_WHILE, TOK_FOR, TOK_IN, TOK_FUNC, TOK_RETURN,
-    TOK_STATIC, TOK_OPERATOR,
+    TOK_STATIC, TOK_OPERATOR, TOK_IMPORT, TOK_FINAL,
 
     TOK_EQ, TOK_ADDEQ, TOK_SUBEQ, TOK_MULEQ, TOK_DIVEQ,
     TOK_ADD, TOK_SUB, TOK_MUL, TOK_DIV, TOK_MOD, 
@@ -5,8 +5,15 @@
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
 #include <Windows.h>
+#include <direct.h>
+#include <process.h>
 #else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
 #endif
 
 const char *file_read(const char *path)
@@ -33,6 +40,89 @@ abort_open:
     return ret;
 }
 
+// Maps a file read-only; where mmap is unavailable the file is read into memory instead.
+const void *file_map(const char *path, size_t *size)
+{
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    const char *data = file_read(path);
+    if (!data) return NULL;
+
+    FILE *f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fclose(f);
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void *data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) data = NULL;
+        else *size = st.st_size;
+    }
+    close(fd);
+    return data;
+#endif
+}
+
+void file_unmap(const void *data, size_t size)
+{
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    free((void*)data);
+#else
+    munmap((void*)data, size);
+#endif
+}
+
+// Moves from over to, replacing to atomically where the platform allows it.
+bool file_replace(const char *from, const char *to)
+{
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+// Succeeds if the directory exists afterwards, whether or not it was created here.
+bool dir_create(const char *path)
+{
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    _mkdir(path);
+    DWORD attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    mkdir(path, 0755);
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+// Absolute path with every link and relative part resolved, so one file always
+// gets the same name; NULL if nothing exists at path.
+char *path_resolve(const char *path)
+{
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    if (GetFileAttributesA(path) == INVALID_FILE_ATTRIBUTES) return NULL;
+    return _fullpath(NULL, path, 0);
+#else
+    return realpath(path, NULL);
+#endif
+}
+
+int process_id()
+{
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    return _getpid();
+#else
+    return getpid();
+#endif
+}
+
 double milliseconds()
 {
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
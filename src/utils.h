@@ -1,7 +1,16 @@
 #ifndef __UTILS__
 #define __UTILS__
 
+#include <stdbool.h>
+#include <stddef.h>
+
 const char *file_read(const char *path);
+const void *file_map(const char *path, size_t *size);
+void file_unmap(const void *data, size_t size);
+bool file_replace(const char *from, const char *to);
+bool dir_create(const char *path);
+char *path_resolve(const char *path);
+int process_id();
 double milliseconds();
 
 #endif
\ No newline at end of file
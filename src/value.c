@@ -5,8 +5,24 @@
 
 #include "debug.h"
 #include "hash.h"
+#include "numconv.h"
 #include "opcodes.h"
 
+class_t *melon_class_object;
+class_t *melon_class_class;
+class_t *melon_class_bool;
+class_t *melon_class_int;
+class_t *melon_class_float;
+class_t *melon_class_null;
+class_t *melon_class_string;
+class_t *melon_class_closure;
+class_t *melon_class_instance;
+class_t *melon_class_array;
+class_t *melon_class_range;
+class_t *melon_class_float64array;
+class_t *melon_class_int32array;
+class_t *melon_class_stringbuilder;
+
 void value_destroy(value_t val)
 {
     if (IS_STR(val))
@@ -21,14 +37,27 @@ void value_destroy(value_t val)
         array_free(AS_ARRAY(val));
     else if (IS_RANGE(val))
         range_free(AS_RANGE(val));
+    else if (IS_TYPEDARRAY(val))
+        typedarray_free(AS_TYPEDARRAY(val));
+    else if (IS_STRBUILDER(val))
+        strbuilder_free(AS_STRBUILDER(val));
 }
 
 void value_print_notag(value_t v)
 {
+    char number[NUMCONV_BUFFER_SIZE];
     if (IS_BOOL(v)) printf("%s", AS_BOOL(v) == 1 ? "true" : "false");
-    if (IS_INT(v)) printf("%d", AS_INT(v));
-    if (IS_STR(v)) printf("%s", AS_STR(v)->s);
-    if (IS_FLOAT(v)) printf("%f", AS_FLOAT(v));
+    if (IS_INT(v))
+    {
+        num_format_int(number, AS_INT(v));
+        fputs(number, stdout);
+    }
+    if (IS_STR(v)) fwrite(string_data(AS_STR(v)), 1, AS_STR(v)->len, stdout);
+    if (IS_FLOAT(v))
+    {
+        num_format_double(number, AS_FLOAT(v));
+        fputs(number, stdout);
+    }
     if (IS_NULL(v)) printf("{null}");
     if (IS_CLOSURE(v))
     {
@@ -40,6 +69,8 @@ void value_print_notag(value_t v)
     if (IS_CLASS(v)) printf("%s", AS_CLASS(v)->identifier);
     if (IS_INSTANCE(v)) printf("{instance}");
     if (IS_ARRAY(v)) array_print(AS_ARRAY(v));
+    if (IS_TYPEDARRAY(v)) typedarray_print(AS_TYPEDARRAY(v));
+    if (IS_STRBUILDER(v)) printf("%.*s", (int)AS_STRBUILDER(v)->len, AS_STRBUILDER(v)->buffer);
 }
 
 void value_print(value_t v)
@@ -55,6 +86,8 @@ void value_print(value_t v)
     }
     if (IS_CLASS(v)) printf("[class]: ");
     if (IS_ARRAY(v)) printf("[array]: ");
+    if (IS_TYPEDARRAY(v)) printf("[typed array]: ");
+    if (IS_STRBUILDER(v)) printf("[string builder]: ");
     value_print_notag(v);
     printf("\n");
 }
@@ -73,7 +106,7 @@ bool value_equals(value_t v1, value_t v2)
     }
     else if (IS_STR(v1))
     {
-        return strcmp(AS_STR(v1)->s, AS_STR(v2)->s) == 0;
+        return string_equals_str(AS_STR(v1), AS_STR(v2));
     }  
     else if (IS_NULL(v1))
     {
@@ -154,16 +187,10 @@ static void internal_disassemble(function_t *func, uint8_t depth)
             uint8_t op = vector_get(func->bytecode, i);
             ninsts++;
             print_tabs(depth + 1); printf("%s", op_to_str((opcode)op));
-            if (op == OP_LOADI || op == OP_STOREL || op == OP_LOADL || op == OP_JIF
-                || op == OP_JMP || op == OP_LOOP || op == OP_LOADK || op == OP_LOADG
-                || op == OP_STOREG || op == OP_CALL || op == OP_LOADU || op == OP_STOREU
-                || op == OP_NEWUP || op == OP_LOADF || op == OP_NEWARR)
+            uint8_t len = op_length((opcode)op);
+            for (uint8_t j = 1; j < len; j++)
             {
-                printf(" %d", vector_get(func->bytecode, ++i));
-            }
-            if (op == OP_NEWUP)
-            {
-                printf(", %d", vector_get(func->bytecode, ++i));
+                printf(j == 1 ? " %d" : ", %d", vector_get(func->bytecode, ++i));
             }
             printf(ninsts % 8 == 0 ? "\n\n" : "\n");
         }
@@ -362,7 +389,7 @@ void class_set_superclass(class_t *c, class_t *super)
 
 void class_bind(class_t *c, const char *key, value_t value)
 {
-    hashtable_set(c->htable, FROM_CSTR(key), value);
+    hashtable_set(c->htable, FROM_ISTR(key), value);
     c->nvars = ((hashtable_t*)c->htable)->nentrys;
 }
 
@@ -416,30 +443,281 @@ void instance_free(instance_t *inst)
 array_t *array_new()
 {
     array_t *a = (array_t*)calloc(1, sizeof(array_t));
-    vector_init(a->arr);
+    a->kind = ARRAY_INT;
     a->size = 0;
+    a->offset = 0;
+    a->buffer = NULL;
+    a->data = NULL;
     return a;
 }
 
+static void array_buffer_release(array_buffer_t *b)
+{
+    if (!b || --b->refs > 0) return;
+    free(b->data);
+    free(b);
+}
+
 void array_free(array_t *a)
 {
-    vector_destroy(a->arr);
+    array_buffer_release(a->buffer);
     free(a);
 }
 
+static size_t array_elem_size(array_kind_e kind)
+{
+    if (kind == ARRAY_INT) return sizeof(int);
+    if (kind == ARRAY_FLOAT) return sizeof(double);
+    return sizeof(value_t);
+}
+
+static uint32_t array_capacity(array_t *a)
+{
+    return a->buffer ? a->buffer->capacity - a->offset : 0;
+}
+
+static void array_rebind(array_t *a)
+{
+    a->data = a->buffer ? (char*)a->buffer->data + a->offset * array_elem_size(a->kind) : NULL;
+}
+
+// Moves the elements of a into a new buffer of the given kind that a owns alone.
+static void array_convert(array_t *a, array_kind_e kind, uint32_t capacity)
+{
+    if (capacity < a->size) capacity = a->size;
+    if (capacity == 0) capacity = VECTOR_DEFAULT_SIZE;
+
+    array_buffer_t *b = (array_buffer_t*)calloc(1, sizeof(array_buffer_t));
+    b->refs = 1;
+    b->capacity = capacity;
+    b->data = malloc(array_elem_size(kind) * capacity);
+
+    if (a->size > 0)
+    {
+        if (kind == a->kind)
+        {
+            memcpy(b->data, a->data, array_elem_size(kind) * a->size);
+        }
+        else
+        {
+            // only generic storage can hold elements of another kind
+            value_t *values = (value_t*)b->data;
+            for (uint32_t i = 0; i < a->size; i++) values[i] = array_get(a, i);
+        }
+    }
+
+    array_buffer_release(a->buffer);
+    a->buffer = b;
+    a->offset = 0;
+    a->kind = kind;
+    array_rebind(a);
+}
+
+static void array_reserve(array_t *a, uint32_t capacity)
+{
+    array_buffer_t *b = a->buffer;
+    if (b && b->refs == 1)
+    {
+        if (a->offset + capacity <= b->capacity) return;
+        if (a->offset == 0)
+        {
+            b->data = realloc(b->data, array_elem_size(a->kind) * capacity);
+            b->capacity = capacity;
+            array_rebind(a);
+            return;
+        }
+    }
+    array_convert(a, a->kind, capacity);
+}
+
+// Must be called before writing to the elements of a.
+static void array_detach(array_t *a)
+{
+    if (a->buffer && a->buffer->refs > 1)
+        array_convert(a, a->kind, a->size);
+}
+
+// Ensures the storage of a can hold v, changing the element kind if needed.
+static void array_accept(array_t *a, value_t v)
+{
+    if (a->kind == ARRAY_GENERIC) return;
+    if (a->kind == ARRAY_INT && IS_INT(v)) return;
+    if (a->kind == ARRAY_FLOAT && IS_FLOAT(v)) return;
+
+    // an empty array takes the kind of its first element
+    if (a->size == 0 && IS_INT(v))
+        array_convert(a, ARRAY_INT, array_capacity(a));
+    else if (a->size == 0 && IS_FLOAT(v))
+        array_convert(a, ARRAY_FLOAT, array_capacity(a));
+    else
+        array_convert(a, ARRAY_GENERIC, array_capacity(a));
+}
+
+static void array_store(array_t *a, uint32_t idx, value_t v)
+{
+    if (a->kind == ARRAY_INT) a->ints[idx] = AS_INT(v);
+    else if (a->kind == ARRAY_FLOAT) a->floats[idx] = AS_FLOAT(v);
+    else a->values[idx] = v;
+}
+
+// Ensures a can hold v and one more element, growing geometrically.
+static void array_grow_for(array_t *a, value_t v)
+{
+    array_accept(a, v);
+    uint32_t capacity = array_capacity(a);
+    if (a->size == capacity)
+        capacity = capacity ? capacity << 1 : VECTOR_DEFAULT_SIZE;
+    array_reserve(a, capacity);
+}
+
 void array_push(array_t *a, value_t v)
 {
-    vector_push(value_t, a->arr, v);
+    array_grow_for(a, v);
+    array_store(a, a->size++, v);
+}
+
+void array_insert_value(array_t *a, uint32_t idx, value_t v)
+{
+    array_grow_for(a, v);
+
+    size_t elem = array_elem_size(a->kind);
+    char *data = (char*)a->data;
+    memmove(data + (idx + 1) * elem, data + idx * elem, (a->size - idx) * elem);
     a->size++;
+    array_store(a, idx, v);
+}
+
+value_t array_get(array_t *a, uint32_t idx)
+{
+    if (a->kind == ARRAY_INT) return FROM_INT(a->ints[idx]);
+    if (a->kind == ARRAY_FLOAT) return FROM_FLOAT(a->floats[idx]);
+    return a->values[idx];
+}
+
+void array_set(array_t *a, uint32_t idx, value_t v)
+{
+    array_accept(a, v);
+    array_detach(a);
+    array_store(a, idx, v);
+}
+
+void array_resize(array_t *a, uint32_t size)
+{
+    if (size <= a->size)
+    {
+        a->size = size;
+        return;
+    }
+
+    // new slots are null, which only generic storage can represent
+    if (a->kind != ARRAY_GENERIC) array_convert(a, ARRAY_GENERIC, size);
+    else array_reserve(a, size);
+
+    for (uint32_t i = a->size; i < size; i++)
+    {
+        a->values[i] = FROM_NULL;
+    }
+    a->size = size;
+}
+
+array_t *array_view(array_t *a, uint32_t start, uint32_t end)
+{
+    array_t *view = array_new();
+    if (end <= start || !a->buffer) return view;
+
+    view->kind = a->kind;
+    view->buffer = a->buffer;
+    view->buffer->refs++;
+    view->offset = a->offset + start;
+    view->size = end - start;
+    array_rebind(view);
+    return view;
+}
+
+void array_insert_range(array_t *a, uint32_t idx, array_t *src, uint32_t start, uint32_t count)
+{
+    if (count == 0) return;
+
+    // inserting a into itself reads through a view that keeps the old elements alive
+    array_t *self = NULL;
+    if (src == a)
+    {
+        src = self = array_view(a, start, start + count);
+        start = 0;
+    }
+
+    array_kind_e kind = a->kind;
+    if (kind != src->kind) kind = a->size == 0 ? src->kind : ARRAY_GENERIC;
+
+    if (kind != a->kind) array_convert(a, kind, a->size + count);
+    else array_reserve(a, a->size + count);
+
+    size_t elem = array_elem_size(kind);
+    char *data = (char*)a->data;
+    memmove(data + (idx + count) * elem, data + idx * elem, (a->size - idx) * elem);
+
+    if (src->kind == kind)
+    {
+        memcpy(data + idx * elem, (char*)src->data + start * elem, count * elem);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; i++) a->values[idx + i] = array_get(src, start + i);
+    }
+    a->size += count;
+
+    if (self) array_free(self);
+}
+
+void array_remove_range(array_t *a, uint32_t idx, uint32_t count)
+{
+    if (count == 0) return;
+    array_detach(a);
+
+    size_t elem = array_elem_size(a->kind);
+    char *data = (char*)a->data;
+    memmove(data + idx * elem, data + (idx + count) * elem, (a->size - idx - count) * elem);
+    a->size -= count;
+}
+
+void array_fill_range(array_t *a, value_t v, uint32_t start, uint32_t end)
+{
+    if (end <= start) return;
+    array_accept(a, v);
+    array_detach(a);
+
+    for (uint32_t i = start; i < end; i++)
+    {
+        array_store(a, i, v);
+    }
+}
+
+void array_reverse_elements(array_t *a)
+{
+    if (a->size < 2) return;
+    array_detach(a);
+
+    size_t elem = array_elem_size(a->kind);
+    char *lo = (char*)a->data;
+    char *hi = lo + (a->size - 1) * elem;
+    char tmp[sizeof(value_t)];
+    while (lo < hi)
+    {
+        memcpy(tmp, lo, elem);
+        memcpy(lo, hi, elem);
+        memcpy(hi, tmp, elem);
+        lo += elem;
+        hi -= elem;
+    }
 }
 
 void array_print(array_t *a)
 {
     printf("[");
-    for (size_t i = 0; i < vector_size(a->arr); i++)
+    for (uint32_t i = 0; i < a->size; i++)
     {
-        value_print_notag(vector_get(a->arr, i));
-        if (i + 1 < vector_size(a->arr))
+        value_print_notag(array_get(a, i));
+        if (i + 1 < a->size)
         {
             printf(", ");
         }
@@ -447,30 +725,436 @@ void array_print(array_t *a)
     printf("]");
 }
 
-string_t *string_new(const char *s)
+typedarray_t *typedarray_new(typed_e kind, uint32_t size)
+{
+    typedarray_t *a = (typedarray_t*)calloc(1, sizeof(typedarray_t));
+    a->kind = kind;
+    a->size = size;
+    if (kind == TYPED_FLOAT64)
+        a->f64 = (double*)calloc(size ? size : 1, sizeof(double));
+    else
+        a->i32 = (int32_t*)calloc(size ? size : 1, sizeof(int32_t));
+    return a;
+}
+
+void typedarray_free(typedarray_t *a)
+{
+    if (a->kind == TYPED_FLOAT64) free(a->f64);
+    else free(a->i32);
+    free(a);
+}
+
+void typedarray_print(typedarray_t *a)
+{
+    printf("[");
+    for (uint32_t i = 0; i < a->size; i++)
+    {
+        char number[NUMCONV_BUFFER_SIZE];
+        if (a->kind == TYPED_FLOAT64) num_format_double(number, a->f64[i]);
+        else num_format_int(number, a->i32[i]);
+        fputs(number, stdout);
+        if (i + 1 < a->size)
+        {
+            printf(", ");
+        }
+    }
+    printf("]");
+}
+
+// Allocates a string with room for len characters and the terminator,
+// inline when it is short enough. The caller fills in the contents.
+static string_t *string_alloc(uint32_t len)
 {
     string_t *str = (string_t*)calloc(1, sizeof(string_t));
-    str->s = strdup(s);
-    str->len = strlen(s);
-    str->hash = hash_string(s);
+    str->s = len < STRING_INLINE_SIZE ? str->buf : (char*)malloc(len + 1);
+    str->len = len;
+    return str;
+}
+
+static void string_free_buffer(string_t *s)
+{
+    if (s->s != s->buf) free((char*)s->s);
+}
+
+string_t *string_new(const char *s)
+{
+    return string_new_len(s, strlen(s));
+}
+
+string_t *string_new_len(const char *s, uint32_t len)
+{
+    string_t *str = string_alloc(len);
+    char *buffer = (char*)str->s;
+    memcpy(buffer, s, len);
+    buffer[len] = '\0';
     return str;
 }
 
 void string_free(string_t *s)
 {
-    free((char*)s->s);
+    // interned strings are owned by the intern table
+    if (s->interned) return;
+    string_free_buffer(s);
     free(s);
 }
 
 string_t *string_copy(string_t *s)
 {
+    return string_new_len(string_data(s), s->len);
+}
+
+string_t *string_concat_str(string_t *s1, string_t *s2)
+{
+    const char *c1 = string_data(s1);
+    const char *c2 = string_data(s2);
+
+    string_t *str = string_alloc(s1->len + s2->len);
+    char *buffer = (char*)str->s;
+    memcpy(buffer, c1, s1->len);
+    memcpy(buffer + s1->len, c2, s2->len);
+    buffer[str->len] = '\0';
+    return str;
+}
+
+string_t *string_rope(string_t *left, string_t *right)
+{
+    string_t *str = (string_t*)calloc(1, sizeof(string_t));
+    str->kind = STRING_ROPE;
+    str->len = left->len + right->len;
+    str->left = left;
+    str->right = right;
+    return str;
+}
+
+// Substrings too short to be worth pointing into the parent are copied inline.
+string_t *string_view(string_t *s, uint32_t start, uint32_t len)
+{
+    const char *data = string_data(s) + start;
+    if (len < STRING_INLINE_SIZE) return string_new_len(data, len);
+
     string_t *str = (string_t*)calloc(1, sizeof(string_t));
-    str->s = strdup(s->s);
-    str->len = s->len;
-    str->hash = s->hash;
+    str->kind = STRING_VIEW;
+    str->len = len;
+    str->parent = s->kind == STRING_VIEW ? s->parent : s;
+    str->start = data;
+    return str;
+}
+
+// Ropes built by appending in a loop are as deep as they are long, so the
+// leaves are collected with an explicit stack instead of recursing.
+static void string_flatten(string_t *s, char *buffer)
+{
+    uint32_t pos = 0;
+    vector_t(string_t*) pending;
+    vector_init(pending);
+    vector_push(string_t*, pending, s);
+    while (vector_size(pending) > 0)
+    {
+        string_t *node = vector_peek(pending);
+        vector_pop(pending);
+        if (node->kind != STRING_ROPE)
+        {
+            memcpy(buffer + pos, string_data(node), node->len);
+            pos += node->len;
+            continue;
+        }
+        vector_push(string_t*, pending, node->right);
+        vector_push(string_t*, pending, node->left);
+    }
+    vector_destroy(pending);
+}
+
+// Returns the characters of s without guaranteeing a terminator, which lets
+// views be read in place. Ropes are flattened.
+const char *string_data(string_t *s)
+{
+    if (s->kind == STRING_VIEW) return s->start;
+    return string_cstr(s);
+}
+
+// Returns the NUL terminated contents of s, turning a rope or view into a
+// flat string the first time.
+const char *string_cstr(string_t *s)
+{
+    if (s->kind == STRING_FLAT) return s->s;
+
+    char *buffer = (char*)malloc(s->len + 1);
+    if (s->kind == STRING_VIEW) memcpy(buffer, s->start, s->len);
+    else string_flatten(s, buffer);
+    buffer[s->len] = '\0';
+
+    s->s = buffer;
+    s->kind = STRING_FLAT;
+    memset(s->buf, 0, sizeof(s->buf));
+    return s->s;
+}
+
+bool string_equals_str(string_t *s1, string_t *s2)
+{
+    if (s1 == s2) return true;
+    if (s1->interned && s2->interned) return false;
+    if (s1->len != s2->len) return false;
+
+    // hashes are only compared when both are already known, computing one
+    // here would cost as much as the comparison itself
+    if (s1->hashed && s2->hashed && s1->hash != s2->hash) return false;
+    return memcmp(string_data(s1), string_data(s2), s1->len) == 0;
+}
+
+// Candidate positions come from memchr on the needle's first byte, which libc
+// implements with wide vector compares, and are confirmed with memcmp.
+int32_t string_find(string_t *s, string_t *needle, uint32_t from)
+{
+    if (from > s->len || needle->len > s->len - from) return -1;
+    if (needle->len == 0) return from;
+
+    const char *hay = string_data(s);
+    const char *n = string_data(needle);
+    const char *p = hay + from;
+    const char *last = hay + s->len - needle->len;
+    while (p <= last)
+    {
+        p = (const char*)memchr(p, n[0], last - p + 1);
+        if (!p) return -1;
+        if (memcmp(p + 1, n + 1, needle->len - 1) == 0) return (int32_t)(p - hay);
+        p++;
+    }
+    return -1;
+}
+
+int32_t string_find_last(string_t *s, string_t *needle)
+{
+    if (needle->len > s->len) return -1;
+    if (needle->len == 0) return s->len;
+
+    const char *hay = string_data(s);
+    const char *n = string_data(needle);
+    for (uint32_t i = s->len - needle->len + 1; i-- > 0;)
+    {
+        if (hay[i] == n[0] && memcmp(hay + i + 1, n + 1, needle->len - 1) == 0) return (int32_t)i;
+    }
+    return -1;
+}
+
+// Replaces every non-overlapping occurrence of from, sizing the result up front.
+string_t *string_replace(string_t *s, string_t *from, string_t *to)
+{
+    if (from->len == 0) return string_copy(s);
+
+    uint32_t count = 0;
+    for (int32_t i = string_find(s, from, 0); i >= 0; i = string_find(s, from, i + from->len)) count++;
+
+    const char *src = string_data(s);
+    const char *rep = string_data(to);
+    string_t *str = string_alloc(s->len - count * from->len + count * to->len);
+    char *dst = (char*)str->s;
+
+    uint32_t pos = 0;
+    for (int32_t i = string_find(s, from, 0); i >= 0; i = string_find(s, from, i + from->len))
+    {
+        memcpy(dst, src + pos, i - pos);
+        dst += i - pos;
+        memcpy(dst, rep, to->len);
+        dst += to->len;
+        pos = i + from->len;
+    }
+    memcpy(dst, src + pos, s->len - pos);
+    dst[s->len - pos] = '\0';
+    return str;
+}
+
+// Concatenates count strings, with sep between them if it is not NULL, into one allocation.
+string_t *string_join(string_t **parts, uint32_t count, string_t *sep)
+{
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < count; i++) len += parts[i]->len;
+    if (sep && count > 1) len += sep->len * (count - 1);
+
+    string_t *str = string_alloc(len);
+    char *dst = (char*)str->s;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (sep && i > 0)
+        {
+            memcpy(dst, string_data(sep), sep->len);
+            dst += sep->len;
+        }
+        memcpy(dst, string_data(parts[i]), parts[i]->len);
+        dst += parts[i]->len;
+    }
+    *dst = '\0';
+    return str;
+}
+
+// Strings are hashed on first use as a key, most runtime temporaries never are.
+uint32_t string_hash(string_t *s)
+{
+    if (!s->hashed)
+    {
+        s->hash = hash_bytes(string_data(s), s->len);
+        s->hashed = true;
+    }
+    return s->hash;
+}
+
+#define INTERN_DEFAULT_SIZE 256
+
+// Open addressing set of every interned string, keyed by contents.
+static struct
+{
+    string_t **slots;
+    uint32_t capacity;
+    uint32_t count;
+} interned = { NULL, 0, 0 };
+
+static uint32_t intern_slot(string_t **slots, uint32_t capacity, const char *s, uint32_t len, uint32_t hash)
+{
+    uint32_t mask = capacity - 1;
+    uint32_t idx = hash & mask;
+    while (slots[idx])
+    {
+        string_t *str = slots[idx];
+        if (str->hash == hash && str->len == len && memcmp(str->s, s, len) == 0) break;
+        idx = (idx + 1) & mask;
+    }
+    return idx;
+}
+
+static void intern_grow()
+{
+    uint32_t capacity = interned.capacity ? interned.capacity << 1 : INTERN_DEFAULT_SIZE;
+    string_t **slots = (string_t**)calloc(capacity, sizeof(string_t*));
+    for (uint32_t i = 0; i < interned.capacity; i++)
+    {
+        string_t *str = interned.slots[i];
+        if (str) slots[intern_slot(slots, capacity, str->s, str->len, str->hash)] = str;
+    }
+    free(interned.slots);
+    interned.slots = slots;
+    interned.capacity = capacity;
+}
+
+static string_t *intern_insert(const char *s, uint32_t len, uint32_t hash)
+{
+    if ((interned.count + 1) * 2 > interned.capacity) intern_grow();
+
+    uint32_t idx = intern_slot(interned.slots, interned.capacity, s, len, hash);
+    if (interned.slots[idx]) return interned.slots[idx];
+
+    string_t *str = string_alloc(len);
+    memcpy((char*)str->s, s, len);
+    ((char*)str->s)[len] = '\0';
+    str->hash = hash;
+    str->hashed = true;
+    str->interned = true;
+    interned.slots[idx] = str;
+    interned.count++;
     return str;
 }
 
+string_t *string_intern(const char *s)
+{
+    return intern_insert(s, strlen(s), hash_string(s));
+}
+
+// Single characters and small ints are turned into strings constantly while
+// scanning and formatting, so their interned copies are cached by value.
+static string_t *char_strings[256];
+static string_t *int_strings[STRING_INT_CACHE_MAX - STRING_INT_CACHE_MIN + 1];
+
+string_t *string_from_char(char c)
+{
+    unsigned char idx = (unsigned char)c;
+    if (!char_strings[idx])
+    {
+        char s[2] = { c, '\0' };
+        char_strings[idx] = intern_insert(s, 1, hash_string(s));
+    }
+    return char_strings[idx];
+}
+
+string_t *string_from_int(int i)
+{
+    bool cacheable = i >= STRING_INT_CACHE_MIN && i <= STRING_INT_CACHE_MAX;
+    if (cacheable && int_strings[i - STRING_INT_CACHE_MIN]) return int_strings[i - STRING_INT_CACHE_MIN];
+
+    char s[NUMCONV_BUFFER_SIZE];
+    int len = num_format_int(s, i);
+    if (!cacheable) return string_new_len(s, len);
+
+    return int_strings[i - STRING_INT_CACHE_MIN] = intern_insert(s, len, hash_string(s));
+}
+
+string_t *string_intern_find(string_t *s)
+{
+    if (s->interned) return s;
+    if (interned.count == 0) return NULL;
+    uint32_t hash = string_hash(s);
+    return interned.slots[intern_slot(interned.slots, interned.capacity, string_data(s), s->len, hash)];
+}
+
+string_t *string_intern_str(string_t *s)
+{
+    if (s->interned) return s;
+    uint32_t hash = string_hash(s);
+    return intern_insert(string_data(s), s->len, hash);
+}
+
+void string_intern_free()
+{
+    for (uint32_t i = 0; i < interned.capacity; i++)
+    {
+        string_t *str = interned.slots[i];
+        if (!str) continue;
+        string_free_buffer(str);
+        free(str);
+    }
+    free(interned.slots);
+    interned.slots = NULL;
+    interned.capacity = 0;
+    interned.count = 0;
+
+    memset(char_strings, 0, sizeof(char_strings));
+    memset(int_strings, 0, sizeof(int_strings));
+}
+
+#define STRBUILDER_DEFAULT_SIZE 64
+
+strbuilder_t *strbuilder_new()
+{
+    strbuilder_t *sb = (strbuilder_t*)calloc(1, sizeof(strbuilder_t));
+    sb->capacity = STRBUILDER_DEFAULT_SIZE;
+    sb->buffer = (char*)malloc(sb->capacity);
+    return sb;
+}
+
+void strbuilder_free(strbuilder_t *sb)
+{
+    free(sb->buffer);
+    free(sb);
+}
+
+void strbuilder_append(strbuilder_t *sb, const char *s, uint32_t len)
+{
+    if (sb->len + len > sb->capacity)
+    {
+        while (sb->len + len > sb->capacity) sb->capacity <<= 1;
+        sb->buffer = (char*)realloc(sb->buffer, sb->capacity);
+    }
+    memcpy(sb->buffer + sb->len, s, len);
+    sb->len += len;
+}
+
+void strbuilder_clear(strbuilder_t *sb)
+{
+    sb->len = 0;
+}
+
+string_t *strbuilder_to_string(strbuilder_t *sb)
+{
+    return string_new_len(sb->buffer, sb->len);
+}
+
 range_t *range_new(int start, int end, int step)
 {
     range_t *range = (range_t*)calloc(1, sizeof(range_t));
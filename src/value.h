@@ -15,17 +15,20 @@ typedef struct closure_s closure_t;
 typedef struct class_s class_t;
 typedef struct class_s object_t;
 
-class_t *melon_class_object;
-class_t *melon_class_class;
-class_t *melon_class_bool;
-class_t *melon_class_int;
-class_t *melon_class_float;
-class_t *melon_class_null;
-class_t *melon_class_string;
-class_t *melon_class_closure;
-class_t *melon_class_instance;
-class_t *melon_class_array;
-class_t *melon_class_range;
+extern class_t *melon_class_object;
+extern class_t *melon_class_class;
+extern class_t *melon_class_bool;
+extern class_t *melon_class_int;
+extern class_t *melon_class_float;
+extern class_t *melon_class_null;
+extern class_t *melon_class_string;
+extern class_t *melon_class_closure;
+extern class_t *melon_class_instance;
+extern class_t *melon_class_array;
+extern class_t *melon_class_range;
+extern class_t *melon_class_float64array;
+extern class_t *melon_class_int32array;
+extern class_t *melon_class_stringbuilder;
 
 typedef struct
 {
@@ -102,20 +105,106 @@ typedef struct closure_s
     upvalue_t **upvalues;
 } closure_t;
 
+// Arrays whose elements are all ints or all floats are stored unboxed. The
+// first store of any other kind of value converts the array to generic storage.
+typedef enum
+{
+    ARRAY_INT, ARRAY_FLOAT, ARRAY_GENERIC
+} array_kind_e;
+
+// Element storage, shared copy-on-write between an array and its slices.
+typedef struct array_buffer_s
+{
+    uint32_t refs;
+    uint32_t capacity;
+    void *data;
+} array_buffer_t;
+
 typedef struct array_s
 {
-    value_r arr;
+    array_kind_e kind;
     uint32_t size;
+    uint32_t offset;
+    array_buffer_t *buffer;
 
+    // first element of this array inside buffer->data
+    union
+    {
+        void *data;
+        int *ints;
+        double *floats;
+        value_t *values;
+    };
 } array_t;
 
-typedef struct
+typedef enum
 {
-    const char *s;
+    TYPED_FLOAT64, TYPED_INT32
+} typed_e;
+
+typedef struct typedarray_s
+{
+    typed_e kind;
+    uint32_t size;
+
+    union
+    {
+        double *f64;
+        int32_t *i32;
+    };
+} typedarray_t;
+
+#define STRING_INLINE_SIZE 16
+
+// Range of ints whose string form is cached by string_from_int.
+#ifndef STRING_INT_CACHE_MIN
+#define STRING_INT_CACHE_MIN -128
+#endif
+#ifndef STRING_INT_CACHE_MAX
+#define STRING_INT_CACHE_MAX 1024
+#endif
+
+typedef enum
+{
+    STRING_FLAT, STRING_ROPE, STRING_VIEW
+} string_kind_e;
+
+typedef struct string_s
+{
+    const char *s;      // NUL terminated contents, NULL for ropes and views
     uint32_t len;
-    uint32_t hash;
+    uint32_t hash;      // only valid once hashed is set, see string_hash
+    uint8_t kind;
+    bool hashed;
+    bool interned;
+
+    // Rope children and view parents are not owned and must outlive the string.
+    union
+    {
+        // The children of a rope, concatenated by string_cstr on first use.
+        struct
+        {
+            struct string_s *left;
+            struct string_s *right;
+        };
+        // A view reads len characters at start, inside its parent's buffer.
+        struct
+        {
+            struct string_s *parent;
+            const char *start;
+        };
+        // Flat strings shorter than STRING_INLINE_SIZE live here, s points at it.
+        char buf[STRING_INLINE_SIZE];
+    };
 } string_t;
 
+typedef struct
+{
+    char *buffer;
+    uint32_t len;
+    uint32_t capacity;
+} strbuilder_t;
+
 typedef struct
 {
     int start;
@@ -130,12 +219,15 @@ typedef struct
 #define FROM_FLOAT(x) (value_t){.type = melon_class_float, .d = x}
 #define FROM_STR(x) (value_t){.type = melon_class_string, .o = (x)}
 #define FROM_CSTR(x) (value_t){.type = melon_class_string, .o = string_new(x)}
+#define FROM_ISTR(x) (value_t){.type = melon_class_string, .o = string_intern(x)}
 #define FROM_CLOSURE(x) (value_t){.type = melon_class_closure, .o = (void*)x}
 #define FROM_CLASS(x) (value_t){.type = melon_class_class, .o = (void*)x}
 #define FROM_INSTANCE(x) (value_t){.type = melon_class_instance, .o = (void*)x}
 #define FROM_ARRAY(x) (value_t){.type = melon_class_array, .o = (void*)x}
 #define FROM_NULL (value_t){.type = melon_class_null, .i = 0}
 #define FROM_RANGE(x) (value_t){.type = melon_class_range, .o = (void*)x};
+#define FROM_TYPEDARRAY(x) (value_t){.type = (x)->kind == TYPED_FLOAT64 ? melon_class_float64array : melon_class_int32array, .o = (void*)(x)}
+#define FROM_STRBUILDER(x) (value_t){.type = melon_class_stringbuilder, .o = (void*)(x)}
 
 #define AS_BOOL(x) (x).i
 #define AS_INT(x) (x).i
@@ -146,6 +238,8 @@ typedef struct
 #define AS_INSTANCE(x) ((instance_t*)(x).o)
 #define AS_ARRAY(x) ((array_t*)(x).o)
 #define AS_RANGE(x) ((range_t*)(x).o)
+#define AS_TYPEDARRAY(x) ((typedarray_t*)(x).o)
+#define AS_STRBUILDER(x) ((strbuilder_t*)(x).o)
 
 #define IS_BOOL(x) ((x).type == melon_class_bool)
 #define IS_INT(x) ((x).type == melon_class_int)
@@ -157,6 +251,8 @@ typedef struct
 #define IS_ARRAY(x) ((x).type == melon_class_array)
 #define IS_NULL(x) ((x).type == melon_class_null)
 #define IS_RANGE(x) ((x).type == melon_class_range)
+#define IS_TYPEDARRAY(x) ((x).type == melon_class_float64array || (x).type == melon_class_int32array)
+#define IS_STRBUILDER(x) ((x).type == melon_class_stringbuilder)
 
 void value_destroy(value_t val);
 void value_print(value_t val);
@@ -193,12 +289,51 @@ void instance_free(instance_t *inst);
 
 array_t *array_new();
 void array_free(array_t *a);
-void array_push(array_t * a, value_t v);
+void array_push(array_t *a, value_t v);
+value_t array_get(array_t *a, uint32_t idx);
+void array_set(array_t *a, uint32_t idx, value_t v);
+void array_resize(array_t *a, uint32_t size);
+array_t *array_view(array_t *a, uint32_t start, uint32_t end);
+void array_insert_value(array_t *a, uint32_t idx, value_t v);
+void array_insert_range(array_t *a, uint32_t idx, array_t *src, uint32_t start, uint32_t count);
+void array_remove_range(array_t *a, uint32_t idx, uint32_t count);
+void array_fill_range(array_t *a, value_t v, uint32_t start, uint32_t end);
+void array_reverse_elements(array_t *a);
 void array_print(array_t *a);
 
+typedarray_t *typedarray_new(typed_e kind, uint32_t size);
+void typedarray_free(typedarray_t *a);
+void typedarray_print(typedarray_t *a);
+
 string_t *string_new(const char *s);
+string_t *string_new_len(const char *s, uint32_t len);
 void string_free(string_t *s);
 string_t *string_copy(string_t *s);
+string_t *string_concat_str(string_t *s1, string_t *s2);
+string_t *string_rope(string_t *left, string_t *right);
+string_t *string_view(string_t *s, uint32_t start, uint32_t len);
+const char *string_data(string_t *s);
+const char *string_cstr(string_t *s);
+uint32_t string_hash(string_t *s);
+bool string_equals_str(string_t *s1, string_t *s2);
+int32_t string_find(string_t *s, string_t *needle, uint32_t from);
+int32_t string_find_last(string_t *s, string_t *needle);
+string_t *string_replace(string_t *s, string_t *from, string_t *to);
+string_t *string_join(string_t **parts, uint32_t count, string_t *sep);
+
+string_t *string_intern(const char *s);
+string_t *string_intern_find(string_t *s);
+string_t *string_intern_str(string_t *s);
+void string_intern_free();
+
+string_t *string_from_char(char c);
+string_t *string_from_int(int i);
+
+strbuilder_t *strbuilder_new();
+void strbuilder_free(strbuilder_t *sb);
+void strbuilder_append(strbuilder_t *sb, const char *s, uint32_t len);
+void strbuilder_clear(strbuilder_t *sb);
+string_t *strbuilder_to_string(strbuilder_t *sb);
 
 range_t *range_new(int start, int end, int step);
 void range_free(range_t *range);
@@ -0,0 +1,239 @@
+#include "vecmath.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define VECMATH_SSE2
+#endif
+
+double vec_f64_sum(const double *a, uint32_t n)
+{
+    uint32_t i = 0;
+    double sum = 0.0;
+#ifdef VECMATH_SSE2
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4)
+    {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(a + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(a + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) sum += a[i];
+    return sum;
+}
+
+double vec_f64_dot(const double *a, const double *b, uint32_t n)
+{
+    uint32_t i = 0;
+    double sum = 0.0;
+#ifdef VECMATH_SSE2
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4)
+    {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+double vec_f64_min(const double *a, uint32_t n)
+{
+    uint32_t i = 1;
+    double m = a[0];
+#ifdef VECMATH_SSE2
+    if (n >= 2)
+    {
+        __m128d acc = _mm_loadu_pd(a);
+        for (i = 2; i + 2 <= n; i += 2)
+        {
+            acc = _mm_min_pd(acc, _mm_loadu_pd(a + i));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        m = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    }
+#endif
+    for (; i < n; i++) if (a[i] < m) m = a[i];
+    return m;
+}
+
+double vec_f64_max(const double *a, uint32_t n)
+{
+    uint32_t i = 1;
+    double m = a[0];
+#ifdef VECMATH_SSE2
+    if (n >= 2)
+    {
+        __m128d acc = _mm_loadu_pd(a);
+        for (i = 2; i + 2 <= n; i += 2)
+        {
+            acc = _mm_max_pd(acc, _mm_loadu_pd(a + i));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        m = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    }
+#endif
+    for (; i < n; i++) if (a[i] > m) m = a[i];
+    return m;
+}
+
+void vec_f64_scale(double *a, double s, uint32_t n)
+{
+    uint32_t i = 0;
+#ifdef VECMATH_SSE2
+    __m128d vs = _mm_set1_pd(s);
+    for (; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(a + i, _mm_mul_pd(_mm_loadu_pd(a + i), vs));
+    }
+#endif
+    for (; i < n; i++) a[i] *= s;
+}
+
+void vec_f64_add(double *a, const double *b, uint32_t n)
+{
+    uint32_t i = 0;
+#ifdef VECMATH_SSE2
+    for (; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(a + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+#endif
+    for (; i < n; i++) a[i] += b[i];
+}
+
+void vec_f64_fill(double *a, double v, uint32_t n)
+{
+    uint32_t i = 0;
+#ifdef VECMATH_SSE2
+    __m128d vv = _mm_set1_pd(v);
+    for (; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(a + i, vv);
+    }
+#endif
+    for (; i < n; i++) a[i] = v;
+}
+
+// Integer sums wrap modulo 2^32, matching the semantics of int addition in the vm.
+int32_t vec_i32_sum(const int32_t *a, uint32_t n)
+{
+    uint32_t i = 0;
+    uint32_t sum = 0;
+#ifdef VECMATH_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4)
+    {
+        acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i*)(a + i)));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; i < n; i++) sum += (uint32_t)a[i];
+    return (int32_t)sum;
+}
+
+// SSE2 has no 32-bit lane multiply, so the multiplying kernels are plain loops
+// that the compiler is free to vectorize when targeting a wider instruction set.
+int32_t vec_i32_dot(const int32_t *a, const int32_t *b, uint32_t n)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) sum += (uint32_t)a[i] * (uint32_t)b[i];
+    return (int32_t)sum;
+}
+
+void vec_i32_scale(int32_t *a, int32_t s, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) a[i] = (int32_t)((uint32_t)a[i] * (uint32_t)s);
+}
+
+#ifdef VECMATH_SSE2
+static __m128i select_epi32(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+int32_t vec_i32_min(const int32_t *a, uint32_t n)
+{
+    uint32_t i = 1;
+    int32_t m = a[0];
+#ifdef VECMATH_SSE2
+    if (n >= 4)
+    {
+        __m128i acc = _mm_loadu_si128((const __m128i*)a);
+        for (i = 4; i + 4 <= n; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(a + i));
+            acc = select_epi32(_mm_cmplt_epi32(v, acc), v, acc);
+        }
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        m = lanes[0];
+        for (int j = 1; j < 4; j++) if (lanes[j] < m) m = lanes[j];
+    }
+#endif
+    for (; i < n; i++) if (a[i] < m) m = a[i];
+    return m;
+}
+
+int32_t vec_i32_max(const int32_t *a, uint32_t n)
+{
+    uint32_t i = 1;
+    int32_t m = a[0];
+#ifdef VECMATH_SSE2
+    if (n >= 4)
+    {
+        __m128i acc = _mm_loadu_si128((const __m128i*)a);
+        for (i = 4; i + 4 <= n; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(a + i));
+            acc = select_epi32(_mm_cmpgt_epi32(v, acc), v, acc);
+        }
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        m = lanes[0];
+        for (int j = 1; j < 4; j++) if (lanes[j] > m) m = lanes[j];
+    }
+#endif
+    for (; i < n; i++) if (a[i] > m) m = a[i];
+    return m;
+}
+
+void vec_i32_add(int32_t *a, const int32_t *b, uint32_t n)
+{
+    uint32_t i = 0;
+#ifdef VECMATH_SSE2
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm_storeu_si128((__m128i*)(a + i), _mm_add_epi32(va, vb));
+    }
+#endif
+    for (; i < n; i++) a[i] = (int32_t)((uint32_t)a[i] + (uint32_t)b[i]);
+}
+
+void vec_i32_fill(int32_t *a, int32_t v, uint32_t n)
+{
+    uint32_t i = 0;
+#ifdef VECMATH_SSE2
+    __m128i vv = _mm_set1_epi32(v);
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm_storeu_si128((__m128i*)(a + i), vv);
+    }
+#endif
+    for (; i < n; i++) a[i] = v;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef __VECMATH__
+#define __VECMATH__
+
+#include <stdint.h>
+
+// Bulk kernels over contiguous numeric buffers. SSE2 is used when the
+// compiler targets it, otherwise every kernel falls back to a scalar loop.
+
+double vec_f64_sum(const double *a, uint32_t n);
+double vec_f64_dot(const double *a, const double *b, uint32_t n);
+double vec_f64_min(const double *a, uint32_t n);
+double vec_f64_max(const double *a, uint32_t n);
+void vec_f64_scale(double *a, double s, uint32_t n);
+void vec_f64_add(double *a, const double *b, uint32_t n);
+void vec_f64_fill(double *a, double v, uint32_t n);
+
+int32_t vec_i32_sum(const int32_t *a, uint32_t n);
+int32_t vec_i32_dot(const int32_t *a, const int32_t *b, uint32_t n);
+int32_t vec_i32_min(const int32_t *a, uint32_t n);
+int32_t vec_i32_max(const int32_t *a, uint32_t n);
+void vec_i32_scale(int32_t *a, int32_t s, uint32_t n);
+void vec_i32_add(int32_t *a, const int32_t *b, uint32_t n);
+void vec_i32_fill(int32_t *a, int32_t v, uint32_t n);
+
+#endif
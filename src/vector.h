@@ -25,6 +25,18 @@
                      (v).a[(v).n++] = (x);                                              \
                  } while (0)               
 
+// Grows through an arena_t instead of realloc; the old buffer stays in the arena.
+#define vector_push_arena(type, v, x, arena) do {                                      \
+                     if ((v).n == (v).m)                                                \
+                     {                                                                  \
+                         size_t _m = (v).m ? (v).m << 1 : VECTOR_DEFAULT_SIZE;          \
+                         (v).a = (type*) arena_grow((arena), (v).a,                     \
+                             sizeof(type) * (v).m, sizeof(type) * _m);                  \
+                         (v).m = _m;                                                    \
+                     }                                                                  \
+                     (v).a[(v).n++] = (x);                                              \
+                 } while (0)
+
 #define vector_copy(type, v, dest) do {                                                 \
                      (dest).n = (v).n;                                                  \
                      (dest).m = (v).m;                                                  \
@@ -2,6 +2,7 @@
 
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "core.h"
 #include "debug.h"
@@ -61,13 +62,11 @@
 
 #define CLASS_LOOKUP(_object, _name, _cl)                                            \
         do {                                                                         \
-            value_t lookup = FROM_CSTR(_name);                                       \
-            value_t *v = class_lookup_super(value_get_class(_object), lookup);       \
-            string_free(AS_STR(lookup));                                             \
+            value_t *v = class_lookup_super(value_get_class(_object), FROM_STR(_name)); \
             if (!v)                                                                  \
             {                                                                        \
                 RUNTIME_ERROR("class %s does not have method '%s'\n",                \
-                    value_get_class(_object)->identifier, _name);                    \
+                    value_get_class(_object)->identifier, (_name)->s);               \
             }                                                                        \
             _cl = AS_CLOSURE(*v);                                                    \
         } while (0)
@@ -117,6 +116,15 @@
             }                                                                        \
             STACK_PUSH(a); STACK_PUSH(b);                     \
 
+// Operands were proven by type inference, so the result replaces the left
+// operand in place without checking either tag.
+#define DO_TYPED_MATH(_from, _field, op)                                             \
+        do {                                                                         \
+            value_t b = STACK_POP;                                                   \
+            value_t *a = &STACK_PEEK;                                                \
+            *a = _from(a->_field op b._field);                                       \
+        } while (0)
+
 #define DO_OVERLOAD_OP(_opstr)                                                       \
         do {                                                                         \
             closure_t *_cl;                                                          \
@@ -293,7 +301,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
         case OP_RET0: 
         {
             close_upvalues(&vm->upvalues, &vm->stack[vm->bp]);
-            STACK_POPN(vm->stacktop - vm->stack - vm->bp + 1);
+            STACK_POPN(vm->stacktop - vm->stack - vm->bp + vector_peek(vm->callstack).caller_stack);
             bool ret = !is_main && vm->bp == ret_bp;
             vm->ip = callstack_ret(&vm->callstack, &vm->closure, &vm->bp);
             if (ret) return;
@@ -314,9 +322,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
                 if (c->meta_inited || !c->metaclass) break;
                 c->static_vars = (value_t*)calloc(c->metaclass->nvars, sizeof(value_t));
                 c->meta_inited = true;
-                value_t lookup = FROM_CSTR(CORE_INIT_STRING);
-                closure_t *init = class_lookup_closure(c->metaclass, lookup);
-                string_free(AS_STR(lookup));
+                closure_t *init = class_lookup_closure(c->metaclass, FROM_STR(core_strings.init));
                 if (init)
                 {
                     CALL_FUNC(init, vm->stacktop - vm->stack - 1, 0);
@@ -333,7 +339,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
         {
             value_t object = STACK_PEEKN(2);
             closure_t *loadf;
-            CLASS_LOOKUP(object, CORE_LOADF_STRING, loadf);
+            CLASS_LOOKUP(object, core_strings.loadf, loadf);
             CALL_FUNC_NOSTACK(loadf, STACK_SIZE - 2, 2, 1);
 
             if (READ_BYTE) STACK_PUSH(object);
@@ -343,7 +349,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
         {
             value_t object = STACK_PEEKN(2);
             closure_t *loada;
-            CLASS_LOOKUP(object, CORE_LOADAT_STRING, loada);
+            CLASS_LOOKUP(object, core_strings.loadat, loada);
             CALL_FUNC_NOSTACK(loada, STACK_SIZE - 2, 2, 1);
             break;
         }
@@ -358,7 +364,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
         {
             value_t object = STACK_PEEKN(2);
             closure_t *storef;
-            CLASS_LOOKUP(object, CORE_STOREF_STRING, storef);
+            CLASS_LOOKUP(object, core_strings.storef, storef);
             CALL_FUNC_NOSTACK(storef, STACK_SIZE - 3, 3, 2);
             break;
         }
@@ -366,7 +372,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
         {
             value_t object = STACK_PEEKN(2);
             closure_t *storea;
-            CLASS_LOOKUP(object, CORE_STOREAT_STRING, storea);
+            CLASS_LOOKUP(object, core_strings.storeat, storea);
             CALL_FUNC_NOSTACK(storea, STACK_SIZE - 3, 3, 2);
             break;
         }
@@ -400,9 +406,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
             {
                 class_t *c = AS_CLASS(v);
 
-                value_t lookup = FROM_CSTR(CORE_NEW_STRING);
-                closure_t *newcl = class_lookup_closure(c->metaclass, lookup);
-                string_free(AS_STR(lookup));
+                closure_t *newcl = class_lookup_closure(c->metaclass, FROM_STR(core_strings.new));
                 if (newcl)
                 {
                     CALL_FUNC(newcl, vm->stacktop - vm->stack - nargs - 1, nargs);
@@ -412,13 +416,13 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
                 value_t instance = FROM_INSTANCE(instance_new(c));
                 vm_push_mem(vm, instance);
 
-                lookup = FROM_CSTR(CORE_INIT_STRING);
-                closure_t *init = class_lookup_closure(c, lookup);
-                string_free(AS_STR(lookup));
+                closure_t *init = class_lookup_closure(c, FROM_STR(core_strings.init));
                 if (!init) RUNTIME_ERROR("missing init function in class %s\n", c->identifier);
 
                 CALL_FUNC(init, vm->stacktop - vm->stack - nargs - 1, nargs);
                 vm->stack[vm->bp] = instance;
+                // $init runs on the slot of the class, which receives the instance it returns
+                if (init->f->type == FUNC_MELON) vector_peek(vm->callstack).caller_stack = false;
 
                 break;
             }
@@ -429,6 +433,26 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
             CALL_FUNC(cl, vm->stacktop - vm->stack - nargs, nargs);
             break;
         }
+        case OP_INVOKE:
+        {
+            uint8_t idx = READ_BYTE;
+            uint8_t nargs = READ_BYTE;
+            value_t object = *(vm->stacktop - nargs);
+            value_t method;
+            if (IS_INSTANCE(object) && idx < AS_INSTANCE(object)->nvars)
+                method = AS_INSTANCE(object)->vars[idx];
+            else if (IS_CLASS(object) && AS_CLASS(object)->static_vars && idx < AS_CLASS(object)->metaclass->nvars)
+                method = AS_CLASS(object)->static_vars[idx];
+            else
+                RUNTIME_ERROR("tried to access an instance variable of non-instance object\n");
+
+            if (!IS_CLOSURE(method))
+                RUNTIME_ERROR("cannot call non-class or non-closure\n");
+
+            // the result replaces the object, as the callee does for CALL
+            CALL_FUNC_NOSTACK(AS_CLOSURE(method), vm->stacktop - vm->stack - nargs, nargs, nargs - 1);
+            break;
+        }
         case OP_JMP: vm->ip += *vm->ip; break;
         case OP_LOOP: vm->ip -= *vm->ip; break;
         case OP_JIF: 
@@ -458,25 +482,25 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
         case OP_ADD: 
         {
             DO_FAST_BIN_MATH(+); 
-            DO_OVERLOAD_OP(CORE_ADD_STRING);
+            DO_OVERLOAD_OP(core_strings.add);
             break;
         }
         case OP_SUB: 
         {
             DO_FAST_BIN_MATH(-); 
-            DO_OVERLOAD_OP(CORE_SUB_STRING);
+            DO_OVERLOAD_OP(core_strings.sub);
             break;
         }
         case OP_MUL: 
         {
             DO_FAST_BIN_MATH(*); 
-            DO_OVERLOAD_OP(CORE_MUL_STRING);
+            DO_OVERLOAD_OP(core_strings.mul);
             break;
         }
         case OP_DIV: 
         {
             DO_FAST_BIN_MATH(/ ); 
-            DO_OVERLOAD_OP(CORE_DIV_STRING);
+            DO_OVERLOAD_OP(core_strings.div);
             break;
         }
         case OP_MOD: DO_FAST_INT_MATH(%); break;
@@ -507,7 +531,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
         case OP_EQ:
         {
             DO_FAST_CMP_MATH(== ); 
-            DO_OVERLOAD_OP(CORE_EQEQ_STRING);
+            DO_OVERLOAD_OP(core_strings.eqeq);
             break;
         }
         case OP_NEQ: 
@@ -516,6 +540,28 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
             break;
         }
 
+        case OP_ADD_II: DO_TYPED_MATH(FROM_INT, i, +); break;
+        case OP_SUB_II: DO_TYPED_MATH(FROM_INT, i, -); break;
+        case OP_MUL_II: DO_TYPED_MATH(FROM_INT, i, *); break;
+        case OP_DIV_II: DO_TYPED_MATH(FROM_INT, i, /); break;
+        case OP_MOD_II: DO_TYPED_MATH(FROM_INT, i, %); break;
+        case OP_LT_II: DO_TYPED_MATH(FROM_BOOL, i, <); break;
+        case OP_GT_II: DO_TYPED_MATH(FROM_BOOL, i, >); break;
+        case OP_LTE_II: DO_TYPED_MATH(FROM_BOOL, i, <=); break;
+        case OP_GTE_II: DO_TYPED_MATH(FROM_BOOL, i, >=); break;
+        case OP_EQ_II: DO_TYPED_MATH(FROM_BOOL, i, ==); break;
+        case OP_NEQ_II: DO_TYPED_MATH(FROM_BOOL, i, !=); break;
+        case OP_ADD_FF: DO_TYPED_MATH(FROM_FLOAT, d, +); break;
+        case OP_SUB_FF: DO_TYPED_MATH(FROM_FLOAT, d, -); break;
+        case OP_MUL_FF: DO_TYPED_MATH(FROM_FLOAT, d, *); break;
+        case OP_DIV_FF: DO_TYPED_MATH(FROM_FLOAT, d, /); break;
+        case OP_LT_FF: DO_TYPED_MATH(FROM_BOOL, d, <); break;
+        case OP_GT_FF: DO_TYPED_MATH(FROM_BOOL, d, >); break;
+        case OP_LTE_FF: DO_TYPED_MATH(FROM_BOOL, d, <=); break;
+        case OP_GTE_FF: DO_TYPED_MATH(FROM_BOOL, d, >=); break;
+        case OP_EQ_FF: DO_TYPED_MATH(FROM_BOOL, d, ==); break;
+        case OP_NEQ_FF: DO_TYPED_MATH(FROM_BOOL, d, !=); break;
+
         case OP_NOT: 
         {
             value_t val = STACK_POP;
@@ -538,6 +584,7 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
             {
                 array_push(a, *(vm->stacktop - len + i));
             }
+            STACK_POPN(len);
             value_t a_val = FROM_ARRAY(a);
             vm_push_mem(vm, a_val);
             STACK_PUSH(a_val);
@@ -558,6 +605,32 @@ static void vm_run(vm_t *vm, bool is_main, uint32_t ret_bp, value_t **ret_val)
             break;
         }
 
+        case OP_CONCAT:
+        {
+            // every part is converted first so the result is allocated once
+            uint8_t n = READ_BYTE;
+            value_t values[UINT8_MAX];
+            string_t *parts[UINT8_MAX];
+            bool converted[UINT8_MAX];
+            // a string conversion may run a closure, which grows the stack and
+            // returns into its top slot, so the operands are read beforehand
+            memcpy(values, vm->stacktop - n, n * sizeof(value_t));
+            for (uint8_t i = 0; i < n; i++)
+            {
+                converted[i] = !IS_STR(values[i]);
+                parts[i] = converted[i] ? core_value_to_string(vm, values[i]) : AS_STR(values[i]);
+            }
+            value_t str = FROM_STR(string_join(parts, n, NULL));
+            for (uint8_t i = 0; i < n; i++)
+            {
+                if (converted[i]) string_free(parts[i]);
+            }
+            STACK_POPN(n);
+            vm_push_mem(vm, str);
+            STACK_PUSH(str);
+            break;
+        }
+
         case OP_HALT: return;
         default: continue;
 